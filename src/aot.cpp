@@ -0,0 +1,378 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <iterator>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "chip8_emulator.hpp"
+
+// ahead-of-time recompiler: disassembles a ROM from START_ADDRESS , builds a control flow graph and
+// writes a C++ translation unit that runs it against Chip8System through Aot_runtime (aot_runtime.hpp).
+// every reachable instruction gets its own case label so any pc the ROM can land on is an entry point ,
+// anything else (BNNN targets we couldn't see , self modified code) drops back into the interpreter.
+
+namespace {
+
+constexpr std::size_t MEMORY_SIZE = Chip8System::MEMORY_SIZE;
+constexpr uint16_t START = Chip8System::START_ADDRESS;
+
+std::string hex(unsigned value, int width = 3) {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "0x%0*X", width, value);
+    return buf;
+}
+
+struct Program {
+    std::array<uint8_t, MEMORY_SIZE> memory{};
+    std::vector<uint8_t> rom;
+    std::vector<bool> code = std::vector<bool>(MEMORY_SIZE, false); // reachable instruction starts
+    std::vector<bool> leader = std::vector<bool>(MEMORY_SIZE, false);
+    std::set<uint16_t> call_targets;
+    std::map<uint16_t, std::set<uint16_t>> return_sites; // subroutine entry -> addresses its callers resume at
+    std::vector<uint16_t> computed_jumps; // BNNN sites , targets depend on V0 at runtime
+
+    uint16_t opcode(uint16_t a) const {return memory[a] << 8u | memory[a + 1];}
+};
+
+enum class Flow : uint8_t {
+    Next, // falls through to a+2
+    Jump, // 1NNN
+    Call, // 2NNN , resumes at a+2
+    Return, // 00EE
+    Skip, // a+2 or a+4
+    Computed, // BNNN
+    Wait // FX0A , resumes at a+2 once a key goes down and up
+};
+
+Flow classify(uint16_t op) {
+    switch(op >> 12) {
+        case 0x0: return op == 0x00EE ? Flow::Return : Flow::Next;
+        case 0x1: return Flow::Jump;
+        case 0x2: return Flow::Call;
+        case 0x3: case 0x4: return Flow::Skip;
+        case 0x5: case 0x9: return (op & 0x000Fu) == 0 ? Flow::Skip : Flow::Next;
+        case 0xB: return Flow::Computed;
+        case 0xE: return ((op & 0x00FFu) == 0x9E || (op & 0x00FFu) == 0xA1) ? Flow::Skip : Flow::Next;
+        case 0xF: return (op & 0x00FFu) == 0x0A ? Flow::Wait : Flow::Next;
+        default: return Flow::Next;
+    }
+}
+
+bool in_range(uint32_t a) {return a + 1 < MEMORY_SIZE;}
+
+void discover(Program& p) {
+    std::vector<uint16_t> work{START};
+    p.leader[START] = true;
+    auto add = [&](uint32_t a, bool is_leader) {
+        if(!in_range(a)) return;
+        if(is_leader) p.leader[a] = true;
+        if(!p.code[a]) work.push_back(static_cast<uint16_t>(a));
+    };
+
+    while(!work.empty()) {
+        const uint16_t a = work.back();
+        work.pop_back();
+        if(p.code[a]) continue;
+        p.code[a] = true;
+
+        const uint16_t op = p.opcode(a);
+        const uint16_t nnn = op & 0x0FFFu;
+        switch(classify(op)) {
+            case Flow::Next: add(a + 2u, false); break;
+            case Flow::Jump: add(nnn, true); break;
+            case Flow::Call:
+                p.call_targets.insert(nnn);
+                add(nnn, true);
+                add(a + 2u, true);
+                break;
+            case Flow::Return: break;
+            case Flow::Skip:
+                add(a + 2u, true);
+                add(a + 4u, true);
+                break;
+            case Flow::Wait: add(a + 2u, true); break;
+            case Flow::Computed: p.computed_jumps.push_back(a); break;
+        }
+    }
+
+    // instructions after a block ending one start new blocks too
+    for(uint32_t a = 0; in_range(a); ++a) {
+        if(!p.code[a]) continue;
+        const Flow f = classify(p.opcode(a));
+        if(f != Flow::Next && in_range(a + 2u) && p.code[a + 2]) p.leader[a + 2] = true;
+    }
+
+    // resolve 00EE: walk each subroutine body (stepping over nested calls) to find its returns ,
+    // those returns go back to every caller's a+2
+    std::map<uint16_t, std::set<uint16_t>> callers; // target -> resume addresses
+    for(uint32_t a = 0; in_range(a); ++a) {
+        if(p.code[a] && classify(p.opcode(a)) == Flow::Call) callers[p.opcode(a) & 0x0FFFu].insert(a + 2u);
+    }
+    for(const auto& [target, resume] : callers) p.return_sites[target] = resume;
+}
+
+// successors of the block ending at instruction a , as text for the CFG comments
+std::string successors(const Program& p, uint16_t a, uint16_t block_start, const std::map<uint16_t, uint16_t>& owner) {
+    const uint16_t op = p.opcode(a);
+    std::ostringstream out;
+    switch(classify(op)) {
+        case Flow::Next: out << hex(a + 2u); break;
+        case Flow::Jump: out << hex(op & 0x0FFFu); break;
+        case Flow::Call: out << "call " << hex(op & 0x0FFFu) << " , resume " << hex(a + 2u); break;
+        case Flow::Skip: out << hex(a + 2u) << " " << hex(a + 4u); break;
+        case Flow::Wait: out << "key wait , " << hex(a + 2u); break;
+        case Flow::Computed: out << "computed (V0 + " << hex(op & 0x0FFFu) << ")"; break;
+        case Flow::Return: {
+            const auto it = owner.find(block_start);
+            if(it == owner.end() || !p.return_sites.count(it->second)) {
+                out << "return (unresolved)";
+                break;
+            }
+            out << "return to";
+            for(uint16_t r : p.return_sites.at(it->second)) out << " " << hex(r);
+            break;
+        }
+    }
+    return out.str();
+}
+
+// which subroutine each block belongs to , found by walking from every call target
+std::map<uint16_t, uint16_t> block_owners(const Program& p) {
+    std::map<uint16_t, uint16_t> owner;
+    for(uint16_t target : p.call_targets) {
+        std::vector<uint16_t> work{target};
+        std::set<uint16_t> seen;
+        uint16_t block = target;
+        while(!work.empty()) {
+            uint16_t a = work.back();
+            work.pop_back();
+            block = a;
+            while(in_range(a) && p.code[a] && seen.insert(a).second) {
+                if(p.leader[a]) block = a;
+                if(!owner.count(block)) owner[block] = target;
+                const uint16_t op = p.opcode(a);
+                const Flow f = classify(op);
+                if(f == Flow::Return || f == Flow::Computed) break;
+                if(f == Flow::Jump) {
+                    work.push_back(op & 0x0FFFu);
+                    break;
+                }
+                if(f == Flow::Skip) work.push_back(a + 4u);
+                a += 2; // calls step over the callee
+            }
+        }
+    }
+    return owner;
+}
+
+void emit_instruction(std::ostream& out, const Program& p, uint16_t a) {
+    const uint16_t op = p.opcode(a);
+    const unsigned x = (op & 0x0F00u) >> 8u;
+    const unsigned y = (op & 0x00F0u) >> 4u;
+    const unsigned nn = op & 0x00FFu;
+    const unsigned nnn = op & 0x0FFFu;
+    const std::string next = hex(a + 2u);
+    const std::string Vx = "V[" + std::to_string(x) + "]";
+    const std::string Vy = "V[" + std::to_string(y) + "]";
+    // cases are emitted in address order , so only fall through when a+2 is the very next case
+    const bool falls_into_next = in_range(a + 2u) && p.code[a + 2] && !p.code[a + 1];
+
+    out << "        case " << hex(a) << ": // " << hex(op, 4) << "\n";
+    out << "            if(done >= budget) { pc = " << hex(a) << "; return done; }\n";
+
+    auto line = [&](const std::string& s) {out << "            " << s << "\n";};
+    auto skip_if = [&](const std::string& cond) {
+        line("++done;");
+        line("if(" + cond + ") { pc = " + hex(a + 4u) + "; continue; }");
+    };
+    auto exec = [&](bool leaves_block) {
+        line("pc = " + next + "; rt.exec(" + hex(op, 4) + ");");
+        line("++done;");
+        if(leaves_block) line("continue;");
+    };
+
+    bool ends = false; // body already transfers control
+    switch(op >> 12) {
+        case 0x0:
+            if(op == 0x00EE) {
+                line("++done; pc = rt.pop(); continue;");
+                ends = true;
+            } else {
+                exec(false);
+            }
+            break;
+        case 0x1: line("++done; pc = " + hex(nnn) + "; continue;"); ends = true; break;
+        case 0x2: line("++done; rt.push(" + next + "); pc = " + hex(nnn) + "; continue;"); ends = true; break;
+        case 0x3: skip_if(Vx + " == " + hex(nn, 2)); break;
+        case 0x4: skip_if(Vx + " != " + hex(nn, 2)); break;
+        case 0x5:
+            if((op & 0x000Fu) == 0) skip_if(Vx + " == " + Vy);
+            else exec(false);
+            break;
+        case 0x9:
+            if((op & 0x000Fu) == 0) skip_if(Vx + " != " + Vy);
+            else exec(false);
+            break;
+        case 0x6: line(Vx + " = " + hex(nn, 2) + "; ++done;"); break;
+        case 0x7: line(Vx + " += " + hex(nn, 2) + "; ++done;"); break;
+        case 0x8:
+            switch(op & 0x000Fu) {
+                case 0x0: line(Vx + " = " + Vy + "; ++done;"); break;
+                case 0x1: line(Vx + " |= " + Vy + "; V[15] = 0; ++done;"); break;
+                case 0x2: line(Vx + " &= " + Vy + "; V[15] = 0; ++done;"); break;
+                case 0x3: line(Vx + " ^= " + Vy + "; V[15] = 0; ++done;"); break;
+                case 0x4: line("{ const unsigned r = " + Vx + " + " + Vy + "; " + Vx + " = static_cast<uint8_t>(r); V[15] = r > 255u; } ++done;"); break;
+                case 0x5: line("{ const bool f = " + Vx + " >= " + Vy + "; " + Vx + " -= " + Vy + "; V[15] = f; } ++done;"); break;
+                case 0x6: line("{ const uint8_t f = " + Vx + " & 1u; " + Vx + " >>= 1; V[15] = f; } ++done;"); break;
+                case 0x7: line("{ const bool f = " + Vy + " >= " + Vx + "; " + Vx + " = " + Vy + " - " + Vx + "; V[15] = f; } ++done;"); break;
+                case 0xE: line("{ const uint8_t f = " + Vx + " >> 7; " + Vx + " <<= 1; V[15] = f; } ++done;"); break;
+                default: exec(false); break;
+            }
+            break;
+        case 0xA: line("I = " + hex(nnn) + "; ++done;"); break;
+        case 0xB: line("++done; pc = V[0] + " + hex(nnn) + "; continue; // computed jump"); ends = true; break;
+        case 0xE: exec(classify(op) == Flow::Skip); ends = classify(op) == Flow::Skip; break; // key skips: the interpreter moves pc
+        case 0xF:
+            switch(nn) {
+                case 0x07: line(Vx + " = rt.delay_timer(); ++done;"); break;
+                case 0x0A: exec(true); ends = true; break;
+                case 0x15: line("rt.delay_timer() = " + Vx + "; ++done;"); break;
+                case 0x18: line("rt.sound_timer() = " + Vx + "; ++done;"); break;
+                case 0x1E: line("I += " + Vx + "; ++done;"); break;
+                case 0x29: line("I = " + hex(Chip8System::FONTS_START_ADDRESS) + " + 5 * " + Vx + "; ++done;"); break;
+                case 0x33:
+                case 0x55: {
+                    const unsigned length = nn == 0x33 ? 3 : x + 1;
+                    line("{ const uint16_t at = I; pc = " + next + "; rt.exec(" + hex(op, 4) + "); ++done;");
+                    line("  if(touches_code(at, " + std::to_string(length) + ")) { rt.code_modified = true; continue; } }");
+                    break;
+                }
+                default: exec(false); break;
+            }
+            break;
+        default: exec(false); break; // C and D
+    }
+    if(!ends && !falls_into_next) line("pc = " + next + "; continue;");
+    else if(!ends) line("[[fallthrough]];");
+}
+
+void emit(std::ostream& out, const Program& p, const std::string& rom_name) {
+    const auto owner = block_owners(p);
+    std::size_t instructions = 0, blocks = 0;
+    for(uint32_t a = 0; in_range(a); ++a) {
+        instructions += p.code[a];
+        blocks += p.code[a] && p.leader[a];
+    }
+
+    out << "// generated by chip8_aot from " << rom_name << " , do not edit\n";
+    out << "// " << instructions << " instructions , " << blocks << " blocks , " << p.call_targets.size() << " subroutines";
+    out << " , " << p.computed_jumps.size() << " computed jumps\n";
+    for(uint16_t a : p.computed_jumps) out << "// BNNN at " << hex(a) << ": target resolved at runtime , unseen targets run in the interpreter\n";
+    out << "#include <cstddef>\n#include <cstdint>\n\n#include \"aot_runtime.hpp\"\n\n";
+
+    out << "const char* const chip8_aot_rom_name = \"" << rom_name << "\";\n";
+    out << "const std::size_t chip8_aot_rom_size = " << p.rom.size() << ";\n";
+    out << "const uint8_t chip8_aot_rom[] = {";
+    for(std::size_t i = 0; i < p.rom.size(); ++i) {
+        if(i % 16 == 0) out << "\n    ";
+        out << hex(p.rom[i], 2) << ",";
+    }
+    out << "\n};\n\n";
+
+    // bitmap of every byte covered by a translated instruction , checked after FX33/FX55
+    std::array<uint64_t, MEMORY_SIZE / 64> map{};
+    for(uint32_t a = 0; in_range(a); ++a) {
+        if(!p.code[a]) continue;
+        map[a >> 6] |= 1ull << (a & 63u);
+        map[(a + 1) >> 6] |= 1ull << ((a + 1) & 63u);
+    }
+    out << "namespace {\n\nconstexpr uint64_t code_map[" << map.size() << "] = {";
+    for(std::size_t i = 0; i < map.size(); ++i) {
+        if(i % 4 == 0) out << "\n    ";
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "0x%016llXull,", static_cast<unsigned long long>(map[i]));
+        out << buf;
+    }
+    out << "\n};\n\n";
+    out << "[[maybe_unused]] bool touches_code(uint16_t at, unsigned length) {\n";
+    out << "    for(unsigned i = 0; i < length; ++i) {\n";
+    out << "        const unsigned a = (at + i) & " << hex(MEMORY_SIZE - 1) << ";\n";
+    out << "        if(code_map[a >> 6] & (1ull << (a & 63u))) return true;\n";
+    out << "    }\n    return false;\n}\n\n} // namespace\n\n";
+
+    out << "uint64_t chip8_aot_run(Aot_runtime& rt, uint64_t budget) {\n";
+    out << "    uint8_t* V = rt.registers();\n";
+    out << "    uint16_t& I = rt.index_reg();\n";
+    out << "    uint16_t& pc = rt.pc();\n";
+    out << "    uint64_t done = 0;\n";
+    out << "    (void)I;\n\n";
+    out << "    while(done < budget) {\n";
+    out << "        if(rt.blocked() || rt.code_modified) { rt.step(); ++done; continue; }\n";
+    out << "        switch(pc) {\n";
+
+    uint16_t block_start = 0;
+    for(uint32_t a = 0; in_range(a); ++a) {
+        if(!p.code[a]) continue;
+        if(p.leader[a]) {
+            block_start = static_cast<uint16_t>(a);
+            // find the end of this block for the successor comment
+            uint32_t end = a;
+            while(in_range(end + 2u) && p.code[end + 2] && !p.leader[end + 2] && classify(p.opcode(end)) == Flow::Next) end += 2;
+            out << "        // block " << hex(a) << " .. " << hex(end) << " -> " << successors(p, end, block_start, owner) << "\n";
+        }
+        emit_instruction(out, p, static_cast<uint16_t>(a));
+    }
+
+    out << "        default: break;\n";
+    out << "        }\n";
+    out << "        // odd , untranslated or computed target: one interpreter step\n";
+    out << "        rt.step();\n";
+    out << "        ++done;\n";
+    out << "    }\n";
+    out << "    return done;\n";
+    out << "}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if(argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <rom> <out.cpp>" << std::endl;
+        return 1;
+    }
+
+    // load through the VM so size checks and the font area match what the interpreter sees
+    Program p;
+    try {
+        Chip8System vm;
+        vm.load_ROM(argv[1]);
+        vm.read_memory(0, p.memory);
+    } catch(const std::exception& ex) {
+        std::cerr << "Failed to load ROM: " << ex.what() << std::endl;
+        return 1;
+    }
+    std::ifstream in(argv[1], std::ios::binary);
+    p.rom.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+    discover(p);
+
+    std::string rom_name = argv[1];
+    const auto slash = rom_name.find_last_of("/\\");
+    if(slash != std::string::npos) rom_name = rom_name.substr(slash + 1);
+
+    std::ofstream out(argv[2]);
+    if(!out) {
+        std::cerr << "Failed to write " << argv[2] << std::endl;
+        return 1;
+    }
+    emit(out, p, rom_name);
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include "aot_runtime.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+
+// runner for a ROM recompiled by chip8_aot. the ROM image is linked in , so there's nothing to load or decode
+// at startup. output matches chip8_headless so the two can be compared directly.
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [--frames N | --instructions N] [--hz N]" << std::endl;
+    std::cerr << "  runs the built-in " << chip8_aot_rom_name << " image , same options as chip8_headless" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    uint64_t frame_budget = 3600;
+    uint64_t cycle_budget = 0; // 0 = run by frames
+    uint64_t cpu_hz = 700;
+    constexpr uint64_t TIMER_HZ = 60;
+
+    for(int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+        if(std::strcmp(argv[i], "--frames") == 0 && has_value) {
+            frame_budget = std::strtoull(argv[++i], nullptr, 10);
+            cycle_budget = 0;
+        } else if(std::strcmp(argv[i], "--instructions") == 0 && has_value) {
+            cycle_budget = std::strtoull(argv[++i], nullptr, 10);
+        } else if(std::strcmp(argv[i], "--hz") == 0 && has_value) {
+            cpu_hz = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if(cpu_hz == 0) {
+        std::cerr << "--hz must be greater than 0" << std::endl;
+        return 1;
+    }
+
+    Chip8System chip8;
+    chip8.load_ROM(chip8_aot_rom, chip8_aot_rom_size);
+    Aot_runtime rt(chip8);
+
+    uint64_t cycles = 0;
+    uint64_t frames = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    while(cycle_budget ? cycles < cycle_budget : frames < frame_budget) {
+        uint64_t frame_end = ((frames + 1) * cpu_hz) / TIMER_HZ;
+        if(cycle_budget && frame_end > cycle_budget) frame_end = cycle_budget;
+        cycles += chip8_aot_run(rt, frame_end - cycles);
+        if(cycles == ((frames + 1) * cpu_hz) / TIMER_HZ) {
+            chip8.tick_timers();
+            ++frames;
+        }
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>(end - start).count();
+    const double safe_elapsed = elapsed > 0.0 ? elapsed : 1e-9;
+
+    std::cout << "rom: " << chip8_aot_rom_name << " (aot)\n"
+              << "cycles: " << cycles << "\n"
+              << "frames: " << frames << "\n"
+              << std::fixed << std::setprecision(6)
+              << "elapsed_s: " << elapsed << "\n"
+              << std::setprecision(0)
+              << "instructions_per_s: " << cycles / safe_elapsed << "\n"
+              << "frames_per_s: " << frames / safe_elapsed << "\n"
+              << "framebuffer_hash: 0x" << std::hex << std::setw(16) << std::setfill('0') << chip8.display_hash()
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "chip8_emulator.hpp"
+
+// glue between code emitted by chip8_aot and the VM. the generated translation unit only ever
+// touches Chip8System through this class , so the VM layout can change without regenerating ROMs.
+class Aot_runtime {
+    public:
+        explicit Aot_runtime(Chip8System& vm) : vm(vm) {}
+
+        uint8_t* registers() {return vm.registers;}
+        uint16_t& index_reg() {return vm.index_reg;}
+        uint16_t& pc() {return vm.program_counter;}
+        uint8_t& delay_timer() {return vm.delay_timer;}
+        uint8_t& sound_timer() {return vm.sound_timer;}
+
+        void push(uint16_t address) {
+            vm.stack[vm.stack_pointer] = address;
+            ++vm.stack_pointer;
+        }
+        uint16_t pop() {
+            --vm.stack_pointer;
+            return vm.stack[vm.stack_pointer];
+        }
+
+        // run one opcode through the table interpreter , pc must already point past it
+        void exec(uint16_t opcode) {
+            vm.opcode = opcode;
+            vm.dispatch(Chip8System::decode(opcode));
+        }
+        // single interpreter step for key waits and addresses the recompiler never saw
+        void step() {vm.cycle();}
+        bool blocked() const {return vm.awaiting_input || vm.awaiting_release;}
+
+        // set by generated code when FX33/FX55 writes over translated code , everything runs dynamically after that
+        bool code_modified{false};
+
+    private:
+        Chip8System& vm;
+};
+
+// symbols every chip8_aot translation unit defines
+extern const char* const chip8_aot_rom_name;
+extern const uint8_t chip8_aot_rom[];
+extern const std::size_t chip8_aot_rom_size;
+uint64_t chip8_aot_run(Aot_runtime& rt, uint64_t budget); // same contract as Chip8System::run
@@ -0,0 +1,470 @@
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+#include "batch.hpp"
+#include "rom_cache.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// byte vectors over lanes: AVX2 when the build allows it , SSE2 on any other x86-64
+#if defined(__AVX2__)
+#define CHIP8_BATCH_SIMD 1
+using vec = __m256i;
+constexpr std::size_t VEC_BYTES = 32;
+inline vec vload(const uint8_t* p) {return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));}
+inline void vstore(uint8_t* p, vec v) {_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);}
+inline vec vset1(uint8_t b) {return _mm256_set1_epi8(static_cast<char>(b));}
+inline vec vadd(vec a, vec b) {return _mm256_add_epi8(a, b);}
+inline vec vadds(vec a, vec b) {return _mm256_adds_epu8(a, b);}
+inline vec vsub(vec a, vec b) {return _mm256_sub_epi8(a, b);}
+inline vec vand(vec a, vec b) {return _mm256_and_si256(a, b);}
+inline vec vandnot(vec a, vec b) {return _mm256_andnot_si256(a, b);}
+inline vec vor(vec a, vec b) {return _mm256_or_si256(a, b);}
+inline vec vxor(vec a, vec b) {return _mm256_xor_si256(a, b);}
+inline vec vcmpeq(vec a, vec b) {return _mm256_cmpeq_epi8(a, b);}
+inline vec vmax(vec a, vec b) {return _mm256_max_epu8(a, b);}
+template<int N> inline vec vsrl16(vec a) {return _mm256_srli_epi16(a, N);}
+#elif defined(__SSE2__)
+#define CHIP8_BATCH_SIMD 1
+using vec = __m128i;
+constexpr std::size_t VEC_BYTES = 16;
+inline vec vload(const uint8_t* p) {return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));}
+inline void vstore(uint8_t* p, vec v) {_mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);}
+inline vec vset1(uint8_t b) {return _mm_set1_epi8(static_cast<char>(b));}
+inline vec vadd(vec a, vec b) {return _mm_add_epi8(a, b);}
+inline vec vadds(vec a, vec b) {return _mm_adds_epu8(a, b);}
+inline vec vsub(vec a, vec b) {return _mm_sub_epi8(a, b);}
+inline vec vand(vec a, vec b) {return _mm_and_si128(a, b);}
+inline vec vandnot(vec a, vec b) {return _mm_andnot_si128(a, b);}
+inline vec vor(vec a, vec b) {return _mm_or_si128(a, b);}
+inline vec vxor(vec a, vec b) {return _mm_xor_si128(a, b);}
+inline vec vcmpeq(vec a, vec b) {return _mm_cmpeq_epi8(a, b);}
+inline vec vmax(vec a, vec b) {return _mm_max_epu8(a, b);}
+template<int N> inline vec vsrl16(vec a) {return _mm_srli_epi16(a, N);}
+#endif
+
+// lane sets the instruction bodies iterate over
+struct All_lanes {
+    std::size_t count;
+    template<class F> void each(F&& f) const {for(std::size_t l = 0; l < count; ++l) f(l);}
+};
+struct Lane_list {
+    const uint32_t* ids;
+    std::size_t count;
+    template<class F> void each(F&& f) const {for(std::size_t i = 0; i < count; ++i) f(ids[i]);}
+};
+
+constexpr uint16_t ADDRESS_MASK = Chip8Batch::MEMORY_SIZE - 1;
+
+// ops whose next pc (or wait state) can differ between lanes that ran them together
+bool may_diverge(uint16_t opcode) {
+    switch(opcode >> 12) {
+        case 0x0: return (opcode & 0x00FFu) == 0xEE; // return addresses can differ after lanes reconverge
+        case 0x3: case 0x4: case 0x5: case 0x9: case 0xB: case 0xE: return true;
+        case 0xF: return (opcode & 0x00FFu) == 0x0A;
+        default: return false;
+    }
+}
+
+} // namespace
+
+Chip8Batch::Chip8Batch(std::size_t lanes, uint32_t seed)
+    : lanes(lanes),
+      stride((lanes + LANE_ALIGN - 1) / LANE_ALIGN * LANE_ALIGN),
+      V(REGISTERS * stride),
+      I(stride),
+      PC(stride, Chip8System::START_ADDRESS),
+      SP(stride),
+      DT(stride),
+      ST(stride),
+      stack(STACK_SIZE * stride),
+      memory(lanes * MEMORY_SIZE),
+      screens(lanes * VIDEO_H),
+      input(lanes * 3 * INPUT_SIZE),
+      awaiting_input(lanes),
+      awaiting_release(lanes),
+      wait_reg(lanes),
+      down_key(lanes),
+      written(MEMORY_SIZE),
+      pc_head(MEMORY_SIZE, NO_LANE),
+      pc_next(lanes),
+      touched(),
+      group() {
+    rng.reserve(lanes);
+    for(std::size_t l = 0; l < lanes; ++l) rng.emplace_back(seed + static_cast<uint32_t>(l));
+    group.reserve(lanes);
+    touched.reserve(MEMORY_SIZE);
+
+    // the font area , every lane starts from the same image
+    const std::shared_ptr<const Rom_image> blank = Rom_cache::blank();
+    for(std::size_t l = 0; l < lanes; ++l) std::copy_n(blank->memory.begin(), MEMORY_SIZE, &memory[l * MEMORY_SIZE]);
+}
+
+void Chip8Batch::load_ROM(const char* path) {
+    // load (and validate) once through the ROM cache , then copy the image to every lane. lanes write to memory
+    // through flat per-lane copies , the SIMD kernels index them directly
+    const std::shared_ptr<const Rom_image> rom = Rom_cache::load(path);
+    // lanes have the classic 4KB , a bigger (XO-CHIP) ROM would run cut short
+    if(rom->rom_size > MEMORY_SIZE - Chip8System::START_ADDRESS) throw std::runtime_error("ROM doesn't fit the batch engine's 4KB lane memory");
+    for(std::size_t l = 0; l < lanes; ++l) std::copy_n(rom->memory.begin(), MEMORY_SIZE, &memory[l * MEMORY_SIZE]);
+    std::fill(written.begin(), written.end(), 0);
+}
+
+uint64_t Chip8Batch::display_hash(std::size_t lane) const {
+    const uint64_t* rows = display(lane);
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for(std::size_t y = 0; y < VIDEO_H; ++y) {
+        for(std::size_t x = 0; x < VIDEO_W; ++x) {
+            hash ^= (rows[y] >> (VIDEO_W - 1 - x)) & 1u;
+            hash *= 0x100000001b3ull;
+        }
+    }
+    return hash;
+}
+
+uint16_t Chip8Batch::fetch(std::size_t lane) const {
+    const uint8_t* mem = &memory[lane * MEMORY_SIZE];
+    const uint16_t pc = PC[lane] & ADDRESS_MASK;
+    return mem[pc] << 8u | mem[(pc + 1) & ADDRESS_MASK];
+}
+
+bool Chip8Batch::wait_lane(std::size_t l) {
+    // same suspension handling as Chip8System::cycle for op_FX0A
+    const uint8_t* pressed = just_pressed(l);
+    if(awaiting_input[l]) {
+        for(uint8_t i = 0; i < INPUT_SIZE; ++i) {
+            if(pressed[i]) {
+                awaiting_input[l] = 0;
+                awaiting_release[l] = 1;
+                down_key[l] = i;
+            }
+        }
+        return !awaiting_input[l];
+    } else if(just_released(l)[down_key[l]]) {
+        V[wait_reg[l] * stride + l] = down_key[l];
+        down_key[l] = 0;
+        wait_reg[l] = 0;
+        awaiting_release[l] = 0;
+        --waiting;
+        return true;
+    }
+    return false;
+}
+
+bool Chip8Batch::lanes_converged() const {
+    if(waiting) return false;
+    const uint16_t pc = PC[0];
+    for(std::size_t l = 1; l < lanes; ++l) {
+        if(PC[l] != pc) return false;
+    }
+    return true;
+}
+
+bool Chip8Batch::exec_simd(uint16_t opcode) {
+#if defined(CHIP8_BATCH_SIMD)
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t y = (opcode & 0x00F0u) >> 4u;
+    const uint8_t nn = opcode & 0x00FFu;
+    uint8_t* Vx = &V[x * stride];
+    uint8_t* Vy = &V[y * stride];
+    uint8_t* VF = &V[0xF * stride];
+    const vec one = vset1(1);
+
+    switch(opcode >> 12) {
+        case 0x6: {
+            const vec value = vset1(nn);
+            for(std::size_t o = 0; o < stride; o += VEC_BYTES) vstore(Vx + o, value);
+            break;
+        }
+        case 0x7: {
+            const vec value = vset1(nn);
+            for(std::size_t o = 0; o < stride; o += VEC_BYTES) vstore(Vx + o, vadd(vload(Vx + o), value));
+            break;
+        }
+        case 0x8:
+            for(std::size_t o = 0; o < stride; o += VEC_BYTES) {
+                const vec a = vload(Vx + o);
+                const vec b = vload(Vy + o);
+                // Vx is written before VF everywhere , same as the interpreter , so x == F ends with the flag
+                switch(opcode & 0x000Fu) {
+                    case 0x0: vstore(Vx + o, b); break;
+                    case 0x1: vstore(Vx + o, vor(a, b)); vstore(VF + o, vset1(0)); break;
+                    case 0x2: vstore(Vx + o, vand(a, b)); vstore(VF + o, vset1(0)); break;
+                    case 0x3: vstore(Vx + o, vxor(a, b)); vstore(VF + o, vset1(0)); break;
+                    case 0x4: {
+                        const vec sum = vadd(a, b);
+                        const vec carry = vandnot(vcmpeq(vadds(a, b), sum), one); // saturating add differs only on overflow
+                        vstore(Vx + o, sum);
+                        vstore(VF + o, carry);
+                        break;
+                    }
+                    case 0x5: {
+                        const vec no_borrow = vand(vcmpeq(vmax(a, b), a), one);
+                        vstore(Vx + o, vsub(a, b));
+                        vstore(VF + o, no_borrow);
+                        break;
+                    }
+                    case 0x6: {
+                        const vec lsb = vand(a, one);
+                        vstore(Vx + o, vand(vsrl16<1>(a), vset1(0x7F)));
+                        vstore(VF + o, lsb);
+                        break;
+                    }
+                    case 0x7: {
+                        const vec no_borrow = vand(vcmpeq(vmax(b, a), b), one);
+                        vstore(Vx + o, vsub(b, a));
+                        vstore(VF + o, no_borrow);
+                        break;
+                    }
+                    case 0xE: {
+                        const vec msb = vand(vsrl16<7>(a), one);
+                        vstore(Vx + o, vadd(a, a));
+                        vstore(VF + o, msb);
+                        break;
+                    }
+                    default: return false;
+                }
+            }
+            break;
+        default:
+            return false;
+    }
+    for(std::size_t l = 0; l < lanes; ++l) PC[l] += 2;
+    return true;
+#else
+    (void)opcode;
+    return false;
+#endif
+}
+
+template<class Lanes>
+void Chip8Batch::exec(uint16_t opcode, const Lanes& lanes) {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t y = (opcode & 0x00F0u) >> 4u;
+    const uint8_t n = opcode & 0x000Fu;
+    const uint8_t nn = opcode & 0x00FFu;
+    const uint16_t nnn = opcode & 0x0FFFu;
+    uint8_t* Vx = &V[x * stride];
+    uint8_t* Vy = &V[y * stride];
+    uint8_t* VF = &V[0xF * stride];
+
+    lanes.each([&](std::size_t l) {PC[l] += 2;});
+
+    // dispatch follows the hybrid profile's nested tables in Chip8System::init_tables (low byte for 0/F , low
+    // nibble for 8/E) , so any other 0NNN is a no-op here too
+    switch(opcode >> 12) {
+        case 0x0:
+            if(nn == 0xE0) lanes.each([&](std::size_t l) {std::fill_n(&screens[l * VIDEO_H], VIDEO_H, 0);});
+            else if(nn == 0xEE) lanes.each([&](std::size_t l) {
+                SP[l] = (SP[l] - 1) & (STACK_SIZE - 1);
+                PC[l] = stack[SP[l] * stride + l];
+            });
+            break;
+        case 0x1: lanes.each([&](std::size_t l) {PC[l] = nnn;}); break;
+        case 0x2:
+            lanes.each([&](std::size_t l) {
+                stack[SP[l] * stride + l] = PC[l];
+                SP[l] = (SP[l] + 1) & (STACK_SIZE - 1);
+                PC[l] = nnn;
+            });
+            break;
+        case 0x3: lanes.each([&](std::size_t l) {PC[l] += (Vx[l] == nn) * 2;}); break;
+        case 0x4: lanes.each([&](std::size_t l) {PC[l] += (Vx[l] != nn) * 2;}); break;
+        case 0x5: lanes.each([&](std::size_t l) {PC[l] += (Vx[l] == Vy[l]) * 2;}); break;
+        case 0x6: lanes.each([&](std::size_t l) {Vx[l] = nn;}); break;
+        case 0x7: lanes.each([&](std::size_t l) {Vx[l] += nn;}); break;
+        case 0x8:
+            switch(n) {
+                case 0x0: lanes.each([&](std::size_t l) {Vx[l] = Vy[l];}); break;
+                case 0x1: lanes.each([&](std::size_t l) {Vx[l] |= Vy[l]; VF[l] = 0;}); break;
+                case 0x2: lanes.each([&](std::size_t l) {Vx[l] &= Vy[l]; VF[l] = 0;}); break;
+                case 0x3: lanes.each([&](std::size_t l) {Vx[l] ^= Vy[l]; VF[l] = 0;}); break;
+                case 0x4: lanes.each([&](std::size_t l) {
+                    const uint16_t ret = Vx[l] + Vy[l];
+                    Vx[l] = ret & 0x00FFu;
+                    VF[l] = ret > 255u;
+                }); break;
+                case 0x5: lanes.each([&](std::size_t l) {
+                    const bool flag = Vx[l] >= Vy[l];
+                    Vx[l] -= Vy[l];
+                    VF[l] = flag;
+                }); break;
+                case 0x6: lanes.each([&](std::size_t l) {
+                    const uint8_t flag = Vx[l] & 0x01u;
+                    Vx[l] >>= 1;
+                    VF[l] = flag;
+                }); break;
+                case 0x7: lanes.each([&](std::size_t l) {
+                    const bool flag = Vy[l] >= Vx[l];
+                    Vx[l] = Vy[l] - Vx[l];
+                    VF[l] = flag;
+                }); break;
+                case 0xE: lanes.each([&](std::size_t l) {
+                    const uint8_t flag = (Vx[l] & 0x80u) >> 7u;
+                    Vx[l] <<= 1;
+                    VF[l] = flag;
+                }); break;
+                default: break;
+            }
+            break;
+        case 0x9: lanes.each([&](std::size_t l) {PC[l] += (Vx[l] != Vy[l]) * 2;}); break;
+        case 0xA: lanes.each([&](std::size_t l) {I[l] = nnn;}); break;
+        case 0xB: lanes.each([&](std::size_t l) {PC[l] = V[l] + nnn;}); break;
+        case 0xC: lanes.each([&](std::size_t l) {Vx[l] = rng[l].next_byte() & nn;}); break;
+        case 0xD:
+            lanes.each([&](std::size_t l) {
+                // row-word sprite kernel , same as Chip8System::op_DXYN
+                const uint8_t* mem = &memory[l * MEMORY_SIZE];
+                uint64_t* rows = &screens[l * VIDEO_H];
+                const uint8_t x_start = Vx[l] % VIDEO_W;
+                const uint8_t y_start = Vy[l] % VIDEO_H;
+                uint64_t collision = 0;
+                for(unsigned i = 0; i < n; ++i) {
+                    const uint64_t sprite = std::rotr(static_cast<uint64_t>(mem[(I[l] + i) & ADDRESS_MASK]) << (VIDEO_W - 8), x_start);
+                    uint64_t& row = rows[(y_start + i) % VIDEO_H];
+                    collision |= row & sprite;
+                    row ^= sprite;
+                }
+                VF[l] = collision != 0;
+            });
+            break;
+        case 0xE:
+            if(n == 0xE) lanes.each([&](std::size_t l) {PC[l] += (keys(l)[Vx[l] & 0xFu] != 0) * 2;});
+            else if(n == 0x1) lanes.each([&](std::size_t l) {PC[l] += (keys(l)[Vx[l] & 0xFu] == 0) * 2;});
+            break;
+        case 0xF:
+            switch(nn) {
+                case 0x07: lanes.each([&](std::size_t l) {Vx[l] = DT[l];}); break;
+                case 0x0A:
+                    lanes.each([&](std::size_t l) {
+                        const uint8_t* pressed = just_pressed(l);
+                        bool found = false;
+                        for(uint8_t i = 0; i < INPUT_SIZE; ++i) {
+                            if(pressed[i]) {
+                                Vx[l] = i;
+                                found = true;
+                            }
+                        }
+                        if(!found) {
+                            awaiting_input[l] = 1;
+                            wait_reg[l] = x;
+                            ++waiting;
+                        }
+                    });
+                    break;
+                case 0x15: lanes.each([&](std::size_t l) {DT[l] = Vx[l];}); break;
+                case 0x18: lanes.each([&](std::size_t l) {ST[l] = Vx[l];}); break;
+                case 0x1E: lanes.each([&](std::size_t l) {I[l] += Vx[l];}); break;
+                case 0x29: lanes.each([&](std::size_t l) {I[l] = Chip8System::FONTS_START_ADDRESS + 5 * Vx[l];}); break;
+                case 0x33:
+                    lanes.each([&](std::size_t l) {
+                        uint8_t* mem = &memory[l * MEMORY_SIZE];
+                        const uint8_t val = Vx[l];
+                        for(uint16_t i = 0; i < 3; ++i) written[(I[l] + i) & ADDRESS_MASK] = 1;
+                        mem[(I[l] + 2) & ADDRESS_MASK] = val % 10;
+                        mem[(I[l] + 1) & ADDRESS_MASK] = (val / 10) % 10;
+                        mem[I[l] & ADDRESS_MASK] = (val / 100) % 10;
+                    });
+                    break;
+                case 0x55:
+                    lanes.each([&](std::size_t l) {
+                        uint8_t* mem = &memory[l * MEMORY_SIZE];
+                        for(uint8_t i = 0; i <= x; ++i) {
+                            mem[(I[l] + i) & ADDRESS_MASK] = V[i * stride + l];
+                            written[(I[l] + i) & ADDRESS_MASK] = 1;
+                        }
+                    });
+                    break;
+                case 0x65:
+                    lanes.each([&](std::size_t l) {
+                        const uint8_t* mem = &memory[l * MEMORY_SIZE];
+                        for(uint8_t i = 0; i <= x; ++i) V[i * stride + l] = mem[(I[l] + i) & ADDRESS_MASK];
+                    });
+                    break;
+                default: break;
+            }
+            break;
+    }
+}
+
+void Chip8Batch::step() {
+    // fast path: every lane at the same pc on the same opcode with nobody waiting on a key
+    if(in_lockstep) {
+        const uint16_t pc = PC[0] & ADDRESS_MASK;
+        const uint16_t op = fetch(0);
+        bool same_code = true;
+        if(written[pc] || written[(pc + 1) & ADDRESS_MASK]) {
+            for(std::size_t l = 1; l < lanes && same_code; ++l) same_code = fetch(l) == op;
+        }
+        if(same_code) {
+            group_count = 1;
+            if(!exec_simd(op)) exec(op, All_lanes{lanes});
+            if(may_diverge(op)) in_lockstep = lanes_converged();
+            return;
+        }
+        in_lockstep = false;
+    }
+
+    // diverged: bucket lanes by pc , each bucket runs as one group. lanes in a key wait step on their own
+    touched.clear();
+    bool woke = false;
+    for(std::size_t l = lanes; l-- > 0;) {
+        if(awaiting_input[l] || awaiting_release[l]) {
+            woke |= wait_lane(l);
+            continue;
+        }
+        const uint16_t pc = PC[l] & ADDRESS_MASK;
+        if(pc_head[pc] == NO_LANE) touched.push_back(pc);
+        pc_next[l] = pc_head[pc];
+        pc_head[pc] = static_cast<uint32_t>(l);
+    }
+    group_count = 0;
+    for(const uint16_t pc : touched) {
+        // same pc almost always means same opcode , lanes that rewrote their code there run alone
+        const uint32_t first = pc_head[pc];
+        const uint16_t op = fetch(first);
+        const bool check_code = written[pc] || written[(pc + 1) & ADDRESS_MASK];
+        group.clear();
+        for(uint32_t l = first; l != NO_LANE; l = pc_next[l]) {
+            if(!check_code || fetch(l) == op) {
+                group.push_back(l);
+            } else {
+                exec(fetch(l), Lane_list{&l, 1});
+                ++group_count;
+            }
+        }
+        pc_head[pc] = NO_LANE;
+        exec(op, Lane_list{group.data(), group.size()});
+        ++group_count;
+    }
+    in_lockstep = lanes_converged();
+    stalled = touched.empty() && !woke;
+}
+
+void Chip8Batch::tick_timers() {
+    for(std::size_t l = 0; l < lanes; ++l) {
+        DT[l] -= DT[l] > 0;
+        ST[l] -= ST[l] > 0;
+    }
+}
+
+uint64_t Chip8Batch::step_frames(uint64_t n) {
+    uint64_t executed = 0;
+    for(uint64_t f = 0; f < n; ++f, ++frame) {
+        // same integer split of cpu_hz over 60Hz frames as the headless runner
+        const uint64_t cycles = ((frame + 1) * cpu_hz) / 60 - (frame * cpu_hz) / 60;
+        // like Chip8System::run , once every lane sits in a key wait that didn't move the rest of the frame is a no-op
+        stalled = false;
+        for(uint64_t c = 0; c < cycles && !stalled; ++c) step();
+        tick_timers();
+        executed += cycles * lanes;
+    }
+    return executed;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "chip8_emulator.hpp"
+#include "rng.hpp"
+
+// N CHIP-8 machines stepped together in structure-of-arrays form (same ROM , separate input per lane).
+// every step runs one instruction on every lane. lanes sitting at the same pc on the same opcode run as a
+// group , and when that group is the whole batch the byte ALU ops go through SSE2/AVX2 kernels.
+// instruction semantics match Chip8System exactly , with the same RNG type seeded per lane.
+class Chip8Batch {
+    public:
+        static constexpr std::size_t REGISTERS = Chip8System::REGISTERS;
+        static constexpr std::size_t STACK_SIZE = Chip8System::STACK_SIZE;
+        static constexpr std::size_t MEMORY_SIZE = Chip8System::MEMORY_SIZE;
+        static constexpr std::size_t VIDEO_H = Chip8System::VIDEO_H;
+        static constexpr std::size_t VIDEO_W = Chip8System::VIDEO_W;
+        static constexpr std::size_t INPUT_SIZE = Chip8System::INPUT_SIZE;
+        static constexpr std::size_t LANE_ALIGN = 32; // one AVX2 register of byte lanes
+
+        explicit Chip8Batch(std::size_t lanes, uint32_t seed = 0x5EED); // lane l seeds its rng with seed + l
+        void load_ROM(const char* path); // same ROM in every lane
+        void set_cpu_hz(uint64_t hz) {cpu_hz = hz;}
+
+        // runs n 60Hz frames (cpu_hz / 60 instructions per lane , then a timer tick) , returns instructions summed over lanes.
+        // input edges are left alone , like Chip8System the caller clears just_pressed/just_released between frames
+        uint64_t step_frames(uint64_t n);
+        void step(); // one instruction (or key wait check) on every lane
+
+        std::size_t size() const {return lanes;}
+        uint8_t* keys(std::size_t lane) {return &input[lane * 3 * INPUT_SIZE];}
+        uint8_t* just_pressed(std::size_t lane) {return keys(lane) + INPUT_SIZE;}
+        uint8_t* just_released(std::size_t lane) {return keys(lane) + 2 * INPUT_SIZE;}
+        const uint64_t* display(std::size_t lane) const {return &screens[lane * VIDEO_H];}
+        uint64_t display_hash(std::size_t lane) const; // same hash as Chip8System::display_hash
+        uint8_t reg(std::size_t lane, std::size_t r) const {return V[r * stride + lane];}
+        uint16_t pc(std::size_t lane) const {return PC[lane];}
+        uint16_t index_reg(std::size_t lane) const {return I[lane];}
+        std::size_t groups_last_step() const {return group_count;} // 1 = fully converged
+        bool converged() const {return in_lockstep;}
+
+    private:
+        std::size_t lanes;
+        std::size_t stride; // lanes rounded up to LANE_ALIGN , row length of every per-register array
+        uint64_t cpu_hz{700};
+        uint64_t frame{0};
+
+        // hot per-lane state , register-major so one register across all lanes is contiguous
+        std::vector<uint8_t> V; // [REGISTERS][stride]
+        std::vector<uint16_t> I;
+        std::vector<uint16_t> PC;
+        std::vector<uint8_t> SP;
+        std::vector<uint8_t> DT;
+        std::vector<uint8_t> ST;
+        std::vector<uint16_t> stack; // [STACK_SIZE][stride]
+
+        // per-lane blocks
+        std::vector<uint8_t> memory; // [lane][MEMORY_SIZE]
+        std::vector<uint64_t> screens; // [lane][VIDEO_H] , same bit layout as plane 0 of Chip8System::lores_display
+        std::vector<uint8_t> input; // [lane][keys , just_pressed , just_released][INPUT_SIZE]
+        std::vector<uint8_t> awaiting_input;
+        std::vector<uint8_t> awaiting_release;
+        std::vector<uint8_t> wait_reg;
+        std::vector<uint8_t> down_key;
+        std::size_t waiting{0}; // lanes inside an FX0A wait
+        std::vector<Pcg32> rng;
+
+        // lockstep tracking: while every lane sits at the same pc we only fetch from lane 0 ,
+        // unless the opcode bytes were ever stored to (FX33/FX55) and so may differ between lanes
+        bool in_lockstep{true};
+        std::vector<uint8_t> written; // [MEMORY_SIZE]
+
+        // step scratch , diverged lanes are bucketed by pc through per-pc linked lists
+        static constexpr uint32_t NO_LANE = UINT32_MAX;
+        std::vector<uint32_t> pc_head; // [MEMORY_SIZE] first lane at each pc
+        std::vector<uint32_t> pc_next; // [lane] next lane at the same pc
+        std::vector<uint16_t> touched; // pcs with a non-empty bucket this step
+        std::vector<uint32_t> group;
+        std::size_t group_count{0};
+        bool stalled{false}; // last step only re-checked key waits , none of which moved
+
+        uint16_t fetch(std::size_t lane) const;
+        bool wait_lane(std::size_t lane); // true if the lane's wait state moved
+        bool exec_simd(uint16_t opcode); // whole batch on one opcode , false if there's no vector kernel for it
+        template<class Lanes> void exec(uint16_t opcode, const Lanes& lanes);
+        void tick_timers();
+        bool lanes_converged() const;
+};
@@ -0,0 +1,385 @@
+#include "chip8_emulator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// micro + macro benchmarks for the VM. every result is ns per executed instruction (lower is better):
+//   handler/<op>   leaf op_* handler called directly on a pre-decoded instruction
+//   dispatch/<op>  same instruction through dispatch() and the nested Table_*_dispatch tables
+//   cycle/<op>     cycle() over memory filled with the instruction (fetch + decode + dispatch)
+//   rom/<engine>/<rom>  whole ROM headless for a fixed number of frames through run()
+// results can be written as JSON/CSV and compared against an earlier run to flag regressions.
+
+// reaches into Chip8System the same way Aot_runtime does , only for benchmark setup
+class Bench_probe {
+    public:
+        using Instruction = Chip8System::Instruction;
+
+        explicit Bench_probe(Chip8System& vm) : vm(vm) {}
+
+        Instruction instruction(uint16_t opcode) const {
+            Instruction ins = Chip8System::decode(opcode);
+            ins.handler = vm.resolve(opcode);
+            return ins;
+        }
+        void handler(const Instruction& ins) {(vm.*ins.handler)(ins);}
+        void dispatch(const Instruction& ins) {vm.dispatch(ins);}
+
+        // registers / I / stack in a state every benchmarked opcode can run from repeatedly
+        void prepare() {
+            for(uint8_t r = 0; r < Chip8System::REGISTERS; ++r) vm.registers[r] = static_cast<uint8_t>(r * 7 + 3);
+            vm.registers[0] = 2;
+            vm.index_reg = 0x300;
+            vm.stack_pointer = 0;
+            vm.program_counter = Chip8System::START_ADDRESS;
+            vm.awaiting_input = false;
+            vm.awaiting_release = false;
+            vm.just_pressed[vm.registers[0xA] & 0xF] = 1; // FX0A finds a key instead of blocking
+        }
+        void fill_program(uint16_t opcode) {
+            for(std::size_t a = Chip8System::START_ADDRESS; a + 1 < Chip8System::MEMORY_SIZE; a += 2) {
+                *vm.writable(a) = opcode >> 8;
+                *vm.writable(a + 1) = opcode & 0xFF;
+            }
+        }
+        uint16_t& pc() {return vm.program_counter;}
+        uint16_t& index_reg() {return vm.index_reg;}
+
+    private:
+        Chip8System& vm;
+};
+
+namespace {
+
+struct Result {
+    std::string name;
+    double ns_per_op;
+    uint64_t ops;
+};
+
+struct Options {
+    uint64_t iterations{2000000}; // per micro benchmark repeat
+    int repeats{5}; // best of
+    uint64_t rom_frames{60000};
+    std::string filter;
+};
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [rom|dir]... [--quick] [--iterations N] [--repeats N] [--rom-frames N] [--filter TEXT]" << std::endl;
+    std::cerr << "       [--format text|json|csv] [--out FILE] [--compare FILE] [--threshold PCT]" << std::endl;
+    std::cerr << "  [rom|dir]         ROMs for the rom/ macro benchmarks , directories are scanned for *.ch8" << std::endl;
+    std::cerr << "  --quick           10x fewer iterations and frames , for smoke runs" << std::endl;
+    std::cerr << "  --iterations N    instructions per micro benchmark repeat (default 2000000)" << std::endl;
+    std::cerr << "  --repeats N       repeats per benchmark , the fastest one is reported (default 5)" << std::endl;
+    std::cerr << "  --rom-frames N    60Hz frames per ROM macro benchmark at 700Hz (default 60000)" << std::endl;
+    std::cerr << "  --filter TEXT     only run benchmarks whose name contains TEXT" << std::endl;
+    std::cerr << "  --format FMT      text (default) , json or csv" << std::endl;
+    std::cerr << "  --out FILE        write results to FILE instead of stdout" << std::endl;
+    std::cerr << "  --compare FILE    json/csv results of an earlier run , exit 3 if anything got slower than --threshold" << std::endl;
+    std::cerr << "  --threshold PCT   allowed slowdown in percent for --compare (default 10)" << std::endl;
+}
+
+// best-of-N wall time for fn() , which must execute ops instructions
+double best_ns(const Options& opt, uint64_t ops, const std::function<void()>& setup, const std::function<void()>& fn) {
+    double best = 1e300;
+    for(int r = 0; r < opt.repeats; ++r) {
+        setup();
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+    }
+    return best / static_cast<double>(ops);
+}
+
+struct Op_case {
+    const char* name;
+    uint16_t opcode;
+    bool in_cycle; // false for control flow that can't repeat back to back in memory (calls / returns / computed jumps)
+};
+
+// one representative encoding per leaf handler
+const Op_case OP_CASES[] = {
+    {"00E0", 0x00E0, true},
+    {"1NNN", 0x1200, true}, // jump to itself , so cycle/1NNN is the same instruction forever
+    {"3XNN", 0x3101, true},
+    {"4XNN", 0x410A, true},
+    {"5XY0", 0x5120, true},
+    {"6XNN", 0x6142, true},
+    {"7XNN", 0x7105, true},
+    {"8XY0", 0x8120, true},
+    {"8XY1", 0x8121, true},
+    {"8XY2", 0x8122, true},
+    {"8XY3", 0x8123, true},
+    {"8XY4", 0x8124, true},
+    {"8XY5", 0x8125, true},
+    {"8XY6", 0x8126, true},
+    {"8XY7", 0x8127, true},
+    {"8XYE", 0x812E, true},
+    {"9XY0", 0x9120, true},
+    {"ANNN", 0xA300, true},
+    {"BNNN", 0xB200, false},
+    {"CXNN", 0xC1FF, true},
+    {"DXYN_aligned", 0xD125, true}, // V1 = 10 , V2 = 17 , 5 rows
+    {"DXYN_15rows", 0xD12F, true},
+    {"EX9E", 0xE19E, true},
+    {"EXA1", 0xE1A1, true},
+    {"FX07", 0xF107, true},
+    {"FX0A", 0xFA0A, true},
+    {"FX15", 0xF115, true},
+    {"FX18", 0xF118, true},
+    {"FX1E", 0xF11E, true},
+    {"FX29", 0xF129, true},
+    {"FX33", 0xF133, true},
+    {"FX55", 0xF555, true},
+    {"FX65", 0xF565, true},
+};
+
+bool wanted(const Options& opt, const std::string& name) {
+    return opt.filter.empty() || name.find(opt.filter) != std::string::npos;
+}
+
+void micro_benchmarks(const Options& opt, std::vector<Result>& results) {
+    Chip8System vm(1);
+    Bench_probe probe(vm);
+    const uint64_t n = opt.iterations;
+
+    for(const Op_case& c : OP_CASES) {
+        const Bench_probe::Instruction ins = probe.instruction(c.opcode);
+        const std::string handler_name = std::string("handler/") + c.name;
+        if(wanted(opt, handler_name)) {
+            const double ns = best_ns(opt, n, [&] {probe.prepare();}, [&] {
+                for(uint64_t i = 0; i < n; ++i) {
+                    probe.handler(ins);
+                    probe.index_reg() = 0x300; // FX1E would otherwise walk I off the end for FX33/55/65 runs
+                }
+            });
+            results.push_back({handler_name, ns, n});
+        }
+        const std::string dispatch_name = std::string("dispatch/") + c.name;
+        if(wanted(opt, dispatch_name)) {
+            const double ns = best_ns(opt, n, [&] {probe.prepare();}, [&] {
+                for(uint64_t i = 0; i < n; ++i) {
+                    probe.dispatch(ins);
+                    probe.index_reg() = 0x300;
+                }
+            });
+            results.push_back({dispatch_name, ns, n});
+        }
+        const std::string cycle_name = std::string("cycle/") + c.name;
+        if(c.in_cycle && wanted(opt, cycle_name)) {
+            // refill between repeats , FX33/FX55 overwrite the program they're running from
+            constexpr uint16_t WRAP = Chip8System::MEMORY_SIZE - 0x20;
+            const double ns = best_ns(opt, n, [&] {probe.prepare(); probe.fill_program(c.opcode);}, [&] {
+                for(uint64_t i = 0; i < n; ++i) {
+                    vm.cycle();
+                    if(probe.pc() >= WRAP) probe.pc() = Chip8System::START_ADDRESS;
+                    probe.index_reg() = 0x100;
+                }
+            });
+            results.push_back({cycle_name, ns, n});
+        }
+    }
+
+    // calls and returns only make sense as a pair
+    if(wanted(opt, "handler/2NNN+00EE")) {
+        const Bench_probe::Instruction call = probe.instruction(0x2300);
+        const Bench_probe::Instruction ret = probe.instruction(0x00EE);
+        const double ns = best_ns(opt, 2 * n, [&] {probe.prepare();}, [&] {
+            for(uint64_t i = 0; i < n; ++i) {
+                probe.handler(call);
+                probe.handler(ret);
+            }
+        });
+        results.push_back({"handler/2NNN+00EE", ns, 2 * n});
+    }
+}
+
+void rom_benchmarks(const Options& opt, const std::vector<std::string>& roms, std::vector<Result>& results) {
+    // engines run every instruction so they stay comparable , cached+idle shows what busy-wait elision saves on top
+    struct Engine_case {const char* name; Chip8System::Engine engine; bool idle_skip;};
+    const Engine_case engines[] = {
+        {"interp", Chip8System::Engine::Interpreter, false},
+        {"cached", Chip8System::Engine::Cached, false},
+        {"jit", Chip8System::Engine::Jit, false},
+        {"cached+idle", Chip8System::Engine::Cached, true},
+    };
+    constexpr uint64_t CPU_HZ = 700;
+    constexpr uint64_t TIMER_HZ = 60;
+    const uint64_t frames = opt.rom_frames;
+    const uint64_t ops = (frames * CPU_HZ) / TIMER_HZ;
+
+    for(const std::string& rom : roms) {
+        const std::string stem = std::filesystem::path(rom).stem().string();
+        for(const Engine_case& e : engines) {
+            const std::string name = std::string("rom/") + e.name + "/" + stem;
+            if(!wanted(opt, name)) continue;
+            std::unique_ptr<Chip8System> vm;
+            const double ns = best_ns(opt, ops, [&] {
+                vm = std::make_unique<Chip8System>(1);
+                vm->set_engine(e.engine);
+                vm->set_idle_skip(e.idle_skip);
+                vm->load_ROM(rom.c_str());
+            }, [&] {
+                uint64_t cycles = 0;
+                for(uint64_t f = 0; f < frames; ++f) {
+                    cycles += vm->run(((f + 1) * CPU_HZ) / TIMER_HZ - cycles);
+                    vm->tick_timers();
+                }
+            });
+            results.push_back({name, ns, ops});
+        }
+    }
+}
+
+void write_results(std::ostream& out, const std::string& format, const std::vector<Result>& results) {
+    if(format == "json") {
+        // one result per line so --compare (and grep) can read it back without a JSON parser
+        out << "{\"suite\": \"chip8_bench\", \"unit\": \"ns_per_op\", \"results\": [\n";
+        for(std::size_t i = 0; i < results.size(); ++i) {
+            out << "  {\"name\": \"" << results[i].name << "\", \"ns_per_op\": " << std::fixed << std::setprecision(4)
+                << results[i].ns_per_op << ", \"ops\": " << results[i].ops << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "]}\n";
+    } else if(format == "csv") {
+        out << "name,ns_per_op,ops\n";
+        for(const Result& r : results) out << r.name << ',' << std::fixed << std::setprecision(4) << r.ns_per_op << ',' << r.ops << '\n';
+    } else {
+        for(const Result& r : results) {
+            out << std::left << std::setw(36) << r.name << std::right << std::fixed << std::setprecision(2) << std::setw(10)
+                << r.ns_per_op << " ns/op  " << std::setprecision(1) << std::setw(8) << 1e3 / r.ns_per_op << " Minstr/s\n";
+        }
+    }
+}
+
+// reads either output format back into name -> ns_per_op
+std::map<std::string, double> read_baseline(const std::string& path) {
+    std::ifstream in(path);
+    if(!in) throw std::runtime_error("can't open " + path);
+    std::map<std::string, double> baseline;
+    std::string line;
+    while(std::getline(in, line)) {
+        const std::size_t name_at = line.find("\"name\": \"");
+        if(name_at != std::string::npos) {
+            const std::size_t start = name_at + 9;
+            const std::size_t end = line.find('"', start);
+            const std::size_t value_at = line.find("\"ns_per_op\": ");
+            if(end == std::string::npos || value_at == std::string::npos) continue;
+            baseline[line.substr(start, end - start)] = std::strtod(line.c_str() + value_at + 13, nullptr);
+            continue;
+        }
+        const std::size_t comma = line.find(',');
+        if(comma == std::string::npos || line.rfind("name,", 0) == 0) continue;
+        baseline[line.substr(0, comma)] = std::strtod(line.c_str() + comma + 1, nullptr);
+    }
+    return baseline;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    std::vector<std::string> roms;
+    std::string format = "text";
+    std::string out_path;
+    std::string compare_path;
+    double threshold = 10.0;
+    bool quick = false;
+
+    for(int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+        if(std::strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else if(std::strcmp(argv[i], "--iterations") == 0 && has_value) {
+            opt.iterations = std::max<uint64_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if(std::strcmp(argv[i], "--repeats") == 0 && has_value) {
+            opt.repeats = std::max(1, std::atoi(argv[++i]));
+        } else if(std::strcmp(argv[i], "--rom-frames") == 0 && has_value) {
+            opt.rom_frames = std::max<uint64_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if(std::strcmp(argv[i], "--filter") == 0 && has_value) {
+            opt.filter = argv[++i];
+        } else if(std::strcmp(argv[i], "--format") == 0 && has_value) {
+            format = argv[++i];
+        } else if(std::strcmp(argv[i], "--out") == 0 && has_value) {
+            out_path = argv[++i];
+        } else if(std::strcmp(argv[i], "--compare") == 0 && has_value) {
+            compare_path = argv[++i];
+        } else if(std::strcmp(argv[i], "--threshold") == 0 && has_value) {
+            threshold = std::strtod(argv[++i], nullptr);
+        } else if(argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else if(std::filesystem::is_directory(argv[i])) {
+            std::vector<std::string> found;
+            for(const auto& entry : std::filesystem::directory_iterator(argv[i])) {
+                if(entry.is_regular_file() && entry.path().extension() == ".ch8") found.push_back(entry.path().string());
+            }
+            std::sort(found.begin(), found.end());
+            roms.insert(roms.end(), found.begin(), found.end());
+        } else {
+            roms.push_back(argv[i]);
+        }
+    }
+    if(format != "text" && format != "json" && format != "csv") {
+        usage(argv[0]);
+        return 1;
+    }
+    if(quick) {
+        opt.iterations = std::max<uint64_t>(1, opt.iterations / 10);
+        opt.rom_frames = std::max<uint64_t>(1, opt.rom_frames / 10);
+    }
+
+    std::vector<Result> results;
+    try {
+        micro_benchmarks(opt, results);
+        rom_benchmarks(opt, roms, results);
+    } catch(const std::exception& ex) {
+        std::cerr << "Benchmark failed: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if(!out_path.empty()) {
+        file.open(out_path);
+        if(!file) {
+            std::cerr << "Can't write " << out_path << std::endl;
+            return 1;
+        }
+    }
+    write_results(out_path.empty() ? std::cout : file, format, results);
+
+    if(compare_path.empty()) return 0;
+    std::map<std::string, double> baseline;
+    try {
+        baseline = read_baseline(compare_path);
+    } catch(const std::exception& ex) {
+        std::cerr << "Failed to read baseline: " << ex.what() << std::endl;
+        return 1;
+    }
+    std::size_t regressions = 0;
+    for(const Result& r : results) {
+        const auto old = baseline.find(r.name);
+        if(old == baseline.end() || old->second <= 0.0) continue;
+        const double change = (r.ns_per_op - old->second) / old->second * 100.0;
+        if(change > threshold) {
+            ++regressions;
+            std::cerr << "REGRESSION " << r.name << ": " << std::fixed << std::setprecision(2) << old->second << " -> "
+                      << r.ns_per_op << " ns/op (+" << std::setprecision(1) << change << "%)" << std::endl;
+        }
+    }
+    std::cerr << regressions << " regression(s) over " << threshold << "% against " << compare_path << std::endl;
+    return regressions ? 3 : 0;
+}
@@ -0,0 +1,293 @@
+#include "breakpoints.hpp"
+#include "chip8_emulator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+void Breakpoints::set_pc(uint16_t pc, bool on) {
+    if(pc >= PC_SPACE || has_pc(pc) == on) return;
+    pc_bits[pc / 64] ^= 1ull << (pc % 64);
+    if(on) ++pc_count;
+    else --pc_count;
+}
+
+bool Breakpoints::toggle_pc(uint16_t pc) {
+    set_pc(pc, !has_pc(pc));
+    return has_pc(pc);
+}
+
+void Breakpoints::add_condition(const Condition& c) {
+    conditions.push_back(c);
+    held.push_back(0);
+}
+
+void Breakpoints::clear() {
+    pc_bits = {};
+    pc_count = 0;
+    watches.clear();
+    conditions.clear();
+    held.clear();
+    resume_pc = NO_PC;
+    hit = {};
+}
+
+static bool holds(const Breakpoints::Condition& c, uint8_t v) {
+    switch(c.op) {
+        case Breakpoints::Compare::Equal: return v == c.value;
+        case Breakpoints::Compare::Not_equal: return v != c.value;
+        case Breakpoints::Compare::Less: return v < c.value;
+        case Breakpoints::Compare::Greater: return v > c.value;
+        case Breakpoints::Compare::Less_equal: return v <= c.value;
+        case Breakpoints::Compare::Greater_equal: return v >= c.value;
+    }
+    return false;
+}
+
+Breakpoints::Hit Breakpoints::check(uint16_t pc, const Access_range& access, const uint8_t* registers) {
+    const bool resuming = pc == resume_pc;
+    resume_pc = NO_PC;
+    Hit found{};
+    // conditions track their state on every check , even the one let through , so they only fire on a change
+    for(std::size_t c = 0; c < conditions.size(); ++c) {
+        const bool now = holds(conditions[c], registers[conditions[c].reg]);
+        if(now && !held[c] && found.kind == Hit::Kind::None) found = {Hit::Kind::Condition, pc, 0, c};
+        held[c] = now;
+    }
+    if(resuming) return {};
+    if(has_pc(pc)) found = {Hit::Kind::Pc, pc, 0, 0};
+    else if(found.kind == Hit::Kind::None && access.count) {
+        const uint32_t last = access.first + access.count - 1;
+        const Access want = access.write ? Access::Write : Access::Read;
+        for(std::size_t w = 0; w < watches.size(); ++w) {
+            const Watch& watch = watches[w];
+            if(!(static_cast<uint8_t>(watch.access) & static_cast<uint8_t>(want))) continue;
+            if(watch.last < access.first || watch.first > last) continue;
+            found = {access.write ? Hit::Kind::Write : Hit::Kind::Read, pc, std::max(watch.first, access.first), w};
+            break;
+        }
+    }
+    if(found.kind != Hit::Kind::None) {
+        hit = found;
+        resume_pc = pc;
+    }
+    return found;
+}
+
+std::string Breakpoints::describe(const Hit& h) const {
+    static constexpr const char* OPS[] = {"==", "!=", "<", ">", "<=", ">="};
+    char buf[96];
+    switch(h.kind) {
+        case Hit::Kind::None: return "none";
+        case Hit::Kind::Pc:
+            std::snprintf(buf, sizeof(buf), "pc 0x%04x", h.pc);
+            break;
+        case Hit::Kind::Read:
+        case Hit::Kind::Write:
+            std::snprintf(buf, sizeof(buf), "%s 0x%04x (watch %zu) at pc 0x%04x", h.kind == Hit::Kind::Read ? "read" : "write",
+                h.address, h.index, h.pc);
+            break;
+        case Hit::Kind::Condition: {
+            const Condition& c = conditions[h.index];
+            std::snprintf(buf, sizeof(buf), "v%x%s%u (condition %zu) at pc 0x%04x", c.reg, OPS[static_cast<int>(c.op)], c.value,
+                h.index, h.pc);
+            break;
+        }
+    }
+    return buf;
+}
+
+// hex with an optional 0x , the whole string has to be a number
+static bool parse_hex(const char* text, uint32_t limit, uint32_t& out) {
+    char* end = nullptr;
+    if(!*text) return false;
+    const unsigned long v = std::strtoul(text, &end, 16);
+    if(*end || v > limit) return false;
+    out = static_cast<uint32_t>(v);
+    return true;
+}
+
+bool Breakpoints::parse_pc(const char* text, uint16_t& out) {
+    uint32_t v = 0;
+    if(!parse_hex(text, PC_SPACE - 1, v)) return false;
+    out = static_cast<uint16_t>(v);
+    return true;
+}
+
+bool Breakpoints::parse_watch(const char* text, Watch& out) {
+    std::string range(text);
+    Watch w{};
+    const std::size_t colon = range.find(':');
+    if(colon != std::string::npos) {
+        const std::string mode = range.substr(colon + 1);
+        if(mode == "r") w.access = Access::Read;
+        else if(mode == "w") w.access = Access::Write;
+        else if(mode == "rw") w.access = Access::Any;
+        else return false;
+        range.resize(colon);
+    }
+    const std::size_t dash = range.find('-');
+    if(!parse_hex(range.substr(0, dash).c_str(), 0xFFFF, w.first)) return false;
+    w.last = w.first;
+    if(dash != std::string::npos && !parse_hex(range.substr(dash + 1).c_str(), 0xFFFF, w.last)) return false;
+    if(w.last < w.first) return false;
+    out = w;
+    return true;
+}
+
+bool Breakpoints::parse_condition(const char* text, Condition& out) {
+    // v or V , one hex digit , an operator , then the value in decimal or 0x hex
+    if((text[0] != 'v' && text[0] != 'V') || !text[1]) return false;
+    uint32_t reg = 0;
+    const char digit[2] = {text[1], 0};
+    if(!parse_hex(digit, 0xF, reg)) return false;
+    static constexpr struct {const char* text; Compare op;} OPS[] = {
+        {"==", Compare::Equal}, {"!=", Compare::Not_equal}, {"<=", Compare::Less_equal}, {">=", Compare::Greater_equal},
+        {"<", Compare::Less}, {">", Compare::Greater},
+    };
+    const char* rest = text + 2;
+    for(const auto& o : OPS) {
+        const std::size_t n = std::strlen(o.text);
+        if(std::strncmp(rest, o.text, n) != 0) continue;
+        char* end = nullptr;
+        if(!rest[n]) return false;
+        const unsigned long v = std::strtoul(rest + n, &end, 0);
+        if(*end || v > 0xFF) return false;
+        out = {static_cast<uint8_t>(reg), o.op, static_cast<uint8_t>(v)};
+        return true;
+    }
+    return false;
+}
+
+// the VM side of breakpoints and tracing lives here rather than in chip8_emulator.cpp so run_checked() is never
+// inlined into run() , where it would crowd out the engines' own inlining
+
+Breakpoints& Chip8System::breakpoints(){
+    if(!breaks) breaks = std::make_unique<Breakpoints>();
+    return *breaks;
+}
+
+uint64_t Chip8System::run_checked(uint64_t budget){
+    // the interpreter one instruction at a time with the check in front of each , waits burn the budget like run()
+    uint64_t done = 0;
+    while(done < budget) {
+        if(awaiting_input || awaiting_release || vblank_wait) {
+            const bool was_input = awaiting_input;
+            const bool was_release = awaiting_release;
+            execute();
+            ++done;
+            if(awaiting_input == was_input && awaiting_release == was_release) return budget;
+            continue;
+        }
+        if(at_break()) return done;
+        if(tracer) traced_execute();
+        else execute();
+        ++done;
+    }
+    return done;
+}
+
+uint64_t Chip8System::run_traced(uint64_t budget){
+    // the cached engine's loop with a record after every instruction. a fused pair runs as its first half through
+    // dispatch() so each half gets its own record , and there's no jit or idle skip: neither runs instructions
+    // one at a time , so they'd leave holes in the trace
+    uint64_t done = 0;
+#ifdef CHIP8_PROFILE
+    // the profiler hooks execute() , so profiling builds trace through the interpreter like run() does
+    for(; done < budget; ++done) traced_execute();
+    return done;
+#endif
+    while(done < budget) {
+        if(awaiting_input || awaiting_release || vblank_wait) {
+            const bool was_input = awaiting_input;
+            const bool was_release = awaiting_release;
+            execute();
+            ++done;
+            if(awaiting_input == was_input && awaiting_release == was_release) return budget;
+            continue;
+        }
+        if(program_counter + 1u >= MEMORY_SIZE) {
+            traced_execute();
+            ++done;
+            continue;
+        }
+        Instruction* ins = &decode_cache[program_counter];
+        if(!ins->handler) ins = &decode_at(program_counter);
+        const uint16_t pc = program_counter;
+        uint64_t before[2];
+        std::memcpy(before, registers, sizeof(before));
+        opcode = ins->opcode;
+        program_counter += 2;
+        if(ins->length == 1) (this->*ins->handler)(*ins);
+        else dispatch(*ins);
+        ++done;
+        record_trace(pc, before);
+    }
+    return done;
+}
+
+void Chip8System::set_tracing(bool on, std::size_t capacity){
+    if(!on) tracer.reset();
+    else if(!tracer || tracer->capacity() != std::bit_ceil(std::max<std::size_t>(capacity, 1))) tracer = std::make_unique<Trace_ring>(capacity);
+    if(tracer && !decode_cache) decode_cache = std::make_unique<Instruction[]>(DECODE_CACHE_SIZE); // run_traced() decodes once
+}
+
+void Chip8System::traced_execute(){
+    if(awaiting_input || awaiting_release || vblank_wait) {
+        execute(); // not an instruction
+        return;
+    }
+    const uint16_t pc = program_counter;
+    uint64_t before[2];
+    std::memcpy(before, registers, sizeof(before));
+    execute();
+    record_trace(pc, before);
+}
+
+void Chip8System::record_trace(uint16_t pc, const uint64_t (&before)[2]){
+    uint64_t after[2];
+    std::memcpy(after, registers, sizeof(after));
+    // lowest changed register from the first differing byte of the two words
+    uint8_t reg = Trace_record::NO_REGISTER;
+    for(std::size_t w = 0; w < 2 && reg == Trace_record::NO_REGISTER; ++w) {
+        const uint64_t diff = before[w] ^ after[w];
+        if(!diff) continue;
+        const int bit = std::endian::native == std::endian::little ? std::countr_zero(diff) : std::countl_zero(diff);
+        reg = static_cast<uint8_t>(w * 8 + bit / 8);
+    }
+    tracer->record(pc, opcode, index_reg, reg, reg < REGISTERS ? registers[reg] : 0);
+}
+
+bool Chip8System::at_break(){
+    const uint16_t op = program_counter + 1u < memory_size ? fetch(program_counter) : 0;
+    return breaks->check(program_counter, next_access(op), registers).kind != Breakpoints::Hit::Kind::None;
+}
+
+Breakpoints::Access_range Chip8System::next_access(uint16_t op) const {
+    // the ranges the handlers below actually touch , for the current profile and resolution
+    const Quirk_flags flags = quirk_flags(quirks);
+    const uint32_t x = (op >> 8u) & 0xFu;
+    const uint32_t y = (op >> 4u) & 0xFu;
+    const uint32_t n = op & 0xFu;
+    switch(op & 0xF000u) {
+        case 0xD000u: {
+            const bool wide = flags.schip_ops && n == 0;
+            uint32_t rows = wide ? 16u : n;
+            const uint32_t height = static_cast<uint32_t>(hires_mode ? HIRES_H : VIDEO_H);
+            if(flags.clip_sprites) rows = std::min(rows, height - registers[y] % height); // rows past the bottom aren't read
+            const uint32_t planes = flags.xochip_ops ? static_cast<uint32_t>(std::popcount(plane_mask)) : 1u;
+            return {index_reg, rows * (wide ? 2u : 1u) * planes, false};
+        }
+        case 0x5000u:
+            if(flags.xochip_ops && (n == 2 || n == 3)) return {index_reg, (x <= y ? y - x : x - y) + 1u, n == 2};
+            break;
+        case 0xF000u:
+            if((op & 0xFFu) == 0x33u) return {index_reg, 3u, true};
+            if((op & 0xFFu) == 0x55u) return {index_reg, x + 1u, true};
+            if((op & 0xFFu) == 0x65u) return {index_reg, x + 1u, false};
+            break;
+    }
+    return {};
+}
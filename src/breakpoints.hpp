@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// debugger stops for Chip8System::run(): pc breakpoints in a bitmap , read/write watchpoints on memory ranges and
+// conditions on a register. while none is armed run() never looks at them. armed , run() steps the interpreter and
+// calls check() before every instruction , so a hit stops with pc on the instruction that would hit it
+class Breakpoints {
+    public:
+        static constexpr std::size_t PC_SPACE = 4096; // pc breakpoints cover the classic 4KB , XO-CHIP code past it never stops
+
+        enum class Access : uint8_t {Read = 1, Write = 2, Any = 3};
+        enum class Compare : uint8_t {Equal, Not_equal, Less, Greater, Less_equal, Greater_equal};
+        struct Watch {
+            uint32_t first{};
+            uint32_t last{}; // inclusive
+            Access access{Access::Any};
+        };
+        // stops when Vreg <op> value becomes true , not on every instruction it stays true
+        struct Condition {
+            uint8_t reg{};
+            Compare op{Compare::Equal};
+            uint8_t value{};
+        };
+        struct Hit {
+            enum class Kind : uint8_t {None, Pc, Read, Write, Condition};
+            Kind kind{Kind::None};
+            uint16_t pc{};
+            uint32_t address{}; // Read/Write: first watched byte the instruction touches
+            std::size_t index{}; // Read/Write/Condition: which watch or condition , in the order they were added
+        };
+        // memory the next instruction reads or writes , worked out from its opcode by Chip8System
+        struct Access_range {
+            uint32_t first{};
+            uint32_t count{0};
+            bool write{false};
+        };
+
+        void set_pc(uint16_t pc, bool on);
+        bool toggle_pc(uint16_t pc); // true when it's now set
+        bool has_pc(uint16_t pc) const {return pc < PC_SPACE && ((pc_bits[pc / 64] >> (pc % 64)) & 1u);}
+        void add_watch(const Watch& w) {watches.push_back(w);}
+        void add_condition(const Condition& c);
+        void clear();
+        bool armed() const {return pc_count || !watches.empty() || !conditions.empty();}
+
+        // before the instruction at pc runs. the instruction a hit stopped on is let through once , so resuming
+        // doesn't stop on it again
+        Hit check(uint16_t pc, const Access_range& access, const uint8_t* registers);
+        const Hit& last_hit() const {return hit;}
+        void clear_hit() {hit = {};}
+        std::string describe(const Hit& h) const; // "write 0x0300 (watch 0) at pc 0x0212"
+
+        // command line forms: "2a4" or "0x2a4" , "300-30f:w" (r , w or rw , rw by default) , "v3==5" (== != < > <= >=)
+        static bool parse_pc(const char* text, uint16_t& out);
+        static bool parse_watch(const char* text, Watch& out);
+        static bool parse_condition(const char* text, Condition& out);
+
+    private:
+        static constexpr uint32_t NO_PC = 0xFFFFFFFFu;
+        std::array<uint64_t, PC_SPACE / 64> pc_bits{};
+        std::size_t pc_count{0};
+        std::vector<Watch> watches;
+        std::vector<Condition> conditions;
+        std::vector<uint8_t> held; // per condition , true at the last check
+        uint32_t resume_pc{NO_PC}; // where the last hit stopped
+        Hit hit{};
+};
@@ -4,47 +4,73 @@
 #include <fstream> 
 #include <random> 
 #include <stdexcept>
+#include <string>
+#include <algorithm>
+#include <bit>
+#include <type_traits>
 
 #include "chip8_emulator.hpp"
+#include "jit.hpp"
+#include "rom_cache.hpp"
 
-uint8_t fontset[Chip8System::FONTS_SIZE] =
-	{
-		0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-		0x20, 0x60, 0x20, 0x20, 0x70, // 1
-		0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-		0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-		0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-		0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-		0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-		0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-		0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-		0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-		0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-		0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-		0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-		0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-		0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-		0xF0, 0x80, 0xF0, 0x80, 0x80  // F
-	};
-
-Chip8System::Chip8System() : rng(std::random_device{}()){
+namespace {
+
+// every row of a screen
+template<class S> constexpr uint64_t all_rows() {return S::HEIGHT >= 64 ? ~0ull : (1ull << S::HEIGHT) - 1;}
+
+} // namespace
+
+#ifndef CHIP8_PROFILE
+// sweeps host thousands of machines , keep one small. memory (paged over the shared ROM image) , dispatch tables ,
+// the decode cache , jit and hires screen all live out of line (the profiler's counters don't)
+static_assert(sizeof(Chip8System) <= 1024, "Chip8System outgrew 1KB");
+#endif
+
+Chip8System::Chip8System() : Chip8System(std::random_device{}()) {}
+
+Chip8System::Chip8System(uint32_t seed) : rng(seed), rng_seed(seed){
     
     // initialize the Program Counter to the start of loaded program memory block
     program_counter = START_ADDRESS;
 
-    // load fonts into memory in the correct address range
-    for(std::size_t i = 0 ; i < FONTS_SIZE; i++){
-        memory[FONTS_START_ADDRESS + i] = fontset[i];
-    }
+    // fonts only until a ROM is loaded
+    map_image(Rom_cache::blank());
     // init function table for dispatching 
     init_tables(); 
 
 }
+Chip8System::~Chip8System() = default;
+
 void Chip8System::init_tables() {
-    
+    // only the SUPER-CHIP based profiles ever leave lores
+    switch(quirks) {
+        case Quirk_profile::Vip: tables = &tables_for<Quirks_vip, Lores_screen>(); break;
+        case Quirk_profile::Chip48: tables = &tables_for<Quirks_chip48, Lores_screen>(); break;
+        case Quirk_profile::Schip:
+            if(hires_mode) tables = &tables_for<Quirks_schip, Hires_screen>();
+            else tables = &tables_for<Quirks_schip, Lores_screen>();
+            break;
+        case Quirk_profile::Xochip:
+            if(hires_mode) tables = &tables_for<Quirks_xochip, Hires_screen>();
+            else tables = &tables_for<Quirks_xochip, Lores_screen>();
+            break;
+        default: tables = &tables_for<Quirks_hybrid, Lores_screen>(); break;
+    }
+}
+
+template<class Q, class S> const Chip8System::Dispatch_tables& Chip8System::tables_for() {
+    static constexpr Dispatch_tables set = make_tables<Q, S>();
+    return set;
+}
+
+template<class Q, class S> constexpr Chip8System::Dispatch_tables Chip8System::make_tables() {
+    Dispatch_tables t{};
+    auto& [table_master, table_0, table_5, table_8, table_E, table_F, fused_draw, fused_wait, fused_count] = t;
+
     // set all possible dispatches to null command to start so we handle all cases gracefully
     table_master.fill(&Chip8System::op_NULL);
     table_0.fill(&Chip8System::op_NULL);
+    table_5.fill(&Chip8System::op_NULL);
     table_8.fill(&Chip8System::op_NULL);
     table_E.fill(&Chip8System::op_NULL);
     table_F.fill(&Chip8System::op_NULL);
@@ -53,35 +79,39 @@ void Chip8System::init_tables() {
     table_master[0x0]=&Chip8System::Table_0_dispatch;
     table_master[0x1]=&Chip8System::op_1NNN;
     table_master[0x2]=&Chip8System::op_2NNN;
-    table_master[0x3]=&Chip8System::op_3XNN;
-    table_master[0x4]=&Chip8System::op_4XNN;
-    table_master[0x5]=&Chip8System::op_5XY0;
+    table_master[0x3]=&Chip8System::op_3XNN<Q>;
+    table_master[0x4]=&Chip8System::op_4XNN<Q>;
+    table_master[0x5]=Q::xochip_ops ? &Chip8System::Table_5_dispatch : &Chip8System::op_5XY0<Q>;
     table_master[0x6]=&Chip8System::op_6XNN;
     table_master[0x7]=&Chip8System::op_7XNN;
     table_master[0x8]=&Chip8System::Table_8_dispatch;
-    table_master[0x9]=&Chip8System::op_9XY0;
+    table_master[0x9]=&Chip8System::op_9XY0<Q>;
     table_master[0xA]=&Chip8System::op_ANNN;
-    table_master[0xB]=&Chip8System::op_BNNN;
+    table_master[0xB]=&Chip8System::op_BNNN<Q>;
     table_master[0xC]=&Chip8System::op_CXNN;
-    table_master[0xD]=&Chip8System::op_DXYN;
+    table_master[0xD]=&Chip8System::op_DXYN<Q, S>;
     table_master[0xE]=&Chip8System::Table_E_dispatch; 
     table_master[0xF]=&Chip8System::Table_F_dispatch; 
     //0 dispatches
-    table_0[0x0]=&Chip8System::op_00E0; 
-    table_0[0xE]=&Chip8System::op_00EE;
+    table_0[0xE0]=&Chip8System::op_00E0<S>; 
+    table_0[0xEE]=&Chip8System::op_00EE;
+    //5 dispatches (XO-CHIP only)
+    table_5[0x0]=&Chip8System::op_5XY0<Q>;
+    table_5[0x2]=&Chip8System::op_5XY2;
+    table_5[0x3]=&Chip8System::op_5XY3;
     //8 dispatches 
     table_8[0x0]=&Chip8System::op_8XY0;
-    table_8[0x1]=&Chip8System::op_8XY1;
-    table_8[0x2]=&Chip8System::op_8XY2;
-    table_8[0x3]=&Chip8System::op_8XY3;
+    table_8[0x1]=&Chip8System::op_8XY1<Q>;
+    table_8[0x2]=&Chip8System::op_8XY2<Q>;
+    table_8[0x3]=&Chip8System::op_8XY3<Q>;
     table_8[0x4]=&Chip8System::op_8XY4;
     table_8[0x5]=&Chip8System::op_8XY5;
-    table_8[0x6]=&Chip8System::op_8XY6;
+    table_8[0x6]=&Chip8System::op_8XY6<Q>;
     table_8[0x7]=&Chip8System::op_8XY7;
-    table_8[0xE]=&Chip8System::op_8XYE;
+    table_8[0xE]=&Chip8System::op_8XYE<Q>;
     //E dispatches
-    table_E[0x1]=&Chip8System::op_EXA1;
-    table_E[0xE]=&Chip8System::op_EX9E;
+    table_E[0x1]=&Chip8System::op_EXA1<Q>;
+    table_E[0xE]=&Chip8System::op_EX9E<Q>;
     //F dispatches 
     table_F[0x07]=&Chip8System::op_FX07;
     table_F[0x0A]=&Chip8System::op_FX0A;
@@ -90,63 +120,359 @@ void Chip8System::init_tables() {
     table_F[0x1E]=&Chip8System::op_FX1E;
     table_F[0x29]=&Chip8System::op_FX29;
     table_F[0x33]=&Chip8System::op_FX33;
-    table_F[0x55]=&Chip8System::op_FX55;
-    table_F[0x65]=&Chip8System::op_FX65;
+    table_F[0x55]=&Chip8System::op_FX55<Q>;
+    table_F[0x65]=&Chip8System::op_FX65<Q>;
+
+    if constexpr(Q::schip_ops) {
+        for(std::size_t n = 0x1; n <= 0xF; ++n) table_0[0xC0 | n]=&Chip8System::op_00CN<S>;
+        table_0[0xFB]=&Chip8System::op_00FB<S>;
+        table_0[0xFC]=&Chip8System::op_00FC<S>;
+        table_0[0xFD]=&Chip8System::op_00FD;
+        table_0[0xFE]=&Chip8System::op_00FE;
+        table_0[0xFF]=&Chip8System::op_00FF;
+        table_F[0x30]=&Chip8System::op_FX30;
+        table_F[0x75]=&Chip8System::op_FX75;
+        table_F[0x85]=&Chip8System::op_FX85;
+    }
+    if constexpr(Q::xochip_ops) {
+        for(std::size_t n = 0x1; n <= 0xF; ++n) table_0[0xD0 | n]=&Chip8System::op_00DN<S>;
+        table_F[0x00]=&Chip8System::op_F000;
+        table_F[0x01]=&Chip8System::op_FN01;
+        // F002 (audio pattern) and FX3A (pitch) stay on op_NULL , the beeper only has the one tone
+    }
+
+    fused_draw = &Chip8System::fused_ANNN_DXYN<Q, S>;
+    fused_wait = &Chip8System::fused_FX07_3XNN<Q>;
+    fused_count = &Chip8System::fused_7XNN_3XNN<Q>;
+    return t;
+}
+
+void Chip8System::dispatch(const Instruction& ins){
+    (this->*tables->table_master[(ins.opcode >> 12)])(ins); 
+}
+void Chip8System::Table_0_dispatch(const Instruction& ins){
+    (this->*tables->table_0[ins.nn])(ins);
+}
+void Chip8System::Table_5_dispatch(const Instruction& ins){
+    (this->*tables->table_5[ins.n])(ins);
+}
+void Chip8System::Table_8_dispatch(const Instruction& ins){
+    (this->*tables->table_8[ins.n])(ins);
+}
+void Chip8System::Table_E_dispatch(const Instruction& ins){
+    (this->*tables->table_E[ins.n])(ins);
 }
+void Chip8System::Table_F_dispatch(const Instruction& ins){
+    (this->*tables->table_F[ins.nn])(ins);
+}
+
+Chip8System::Instruction Chip8System::decode(uint16_t opcode){
+    Instruction ins{};
+    ins.opcode = opcode;
+    ins.nnn = opcode & 0x0FFFu;
+    ins.x = (opcode & 0x0F00u) >> 8u;
+    ins.y = (opcode & 0x00F0u) >> 4u;
+    ins.nn = opcode & 0x00FFu;
+    ins.n = opcode & 0x000Fu;
+    return ins;
+}
+
+Chip8System::Chip8Func Chip8System::resolve(uint16_t opcode) const {
+    // walk the nested tables once to find the leaf handler, without executing anything
+    const Chip8Func fn = tables->table_master[opcode >> 12];
+    if(fn == &Chip8System::Table_0_dispatch) return tables->table_0[opcode & 0x00FFu];
+    if(fn == &Chip8System::Table_5_dispatch) return tables->table_5[opcode & 0x000Fu];
+    if(fn == &Chip8System::Table_8_dispatch) return tables->table_8[opcode & 0x000Fu];
+    if(fn == &Chip8System::Table_E_dispatch) return tables->table_E[opcode & 0x000Fu];
+    if(fn == &Chip8System::Table_F_dispatch) return tables->table_F[opcode & 0x00FFu];
+    return fn;
+}
+
+Chip8System::Instruction& Chip8System::decode_at(uint16_t address){
+    Instruction& ins = decode_cache[address];
+    ins = decode(read(address) << 8u | read(address + 1));
+    ins.handler = resolve(ins.opcode);
 
-void Chip8System::dispatch(){
-    (this->*table_master[(opcode >> 12)])(); 
+    // look one instruction ahead for a pair we have a fused handler for
+    if(address + 3u >= MEMORY_SIZE) return ins;
+    Instruction& next = decode_cache[address + 2];
+    if(!next.handler) {
+        next = decode(read(address + 2) << 8u | read(address + 3));
+        next.handler = resolve(next.opcode);
+    }
+    // don't chain fused entries , the second half always runs as a plain instruction
+    Chip8Func fused = nullptr;
+    if(ins.handler == &Chip8System::op_ANNN && next.handler == tables->table_master[0xD]) fused = tables->fused_draw;
+    else if(ins.handler == &Chip8System::op_6XNN && next.handler == &Chip8System::op_6XNN) fused = &Chip8System::fused_6XNN_6XNN;
+    else if(ins.handler == &Chip8System::op_FX07 && next.handler == tables->table_master[0x3] && ins.x == next.x) fused = tables->fused_wait;
+    else if(ins.handler == &Chip8System::op_7XNN && next.handler == tables->table_master[0x3] && ins.x == next.x) fused = tables->fused_count;
+    if(fused) {
+        ins.handler = fused;
+        ins.length = 2;
+    }
+    return ins;
+}
+
+void Chip8System::invalidate_code(uint16_t address, std::size_t length){
+    address &= memory_size - 1;
+    if(address + length > memory_size) { // the write wrapped , its tail landed at the bottom of memory
+        invalidate_code(0, address + length - memory_size);
+        length = memory_size - address;
+    }
+    if(jit) jit->invalidate(address, length);
+    if(!decode_cache) return;
+    // an entry at pc covers pc..pc+1 , or pc..pc+3 when fused , so walk back far enough to catch pairs
+    std::size_t first = address >= 3 ? address - 3u : 0;
+    std::size_t last = address + length - 1;
+    if(last >= MEMORY_SIZE) last = MEMORY_SIZE - 1;
+    for(std::size_t a = first; a <= last; ++a){
+        decode_cache[a].handler = nullptr;
+    }
 }
-void Chip8System::Table_0_dispatch(){
-    (this->*table_0[opcode & 0x000Fu])();
+
+void Chip8System::mark_dirty(uint16_t address, std::size_t length){
+    const unsigned shift = std::countr_zero(state_page_size());
+    const std::size_t first = (address & (memory_size - 1)) >> shift;
+    const std::size_t last = first + (((address & (state_page_size() - 1)) + length - 1) >> shift);
+    for(std::size_t page = first; page <= last; ++page) dirty_pages |= 1ull << (page % STATE_PAGES); // a wrapped write dirties page 0
+    ++memory_writes;
 }
-void Chip8System::Table_8_dispatch(){
-    (this->*table_8[(opcode & 0x000Fu )])();
+
+void Chip8System::seed(uint32_t value){
+    rng_seed = value;
+    rng_draws = 0;
+    rng.seed(value);
 }
-void Chip8System::Table_E_dispatch(){
-    (this->*table_E[(opcode & 0x000Fu)])();
+
+void Chip8System::clear_decode_cache(){
+    if(jit) jit->flush();
+    if(!decode_cache) return;
+    for(std::size_t i = 0 ; i < DECODE_CACHE_SIZE; ++i) decode_cache[i].handler = nullptr;
 }
-void Chip8System::Table_F_dispatch(){
-    (this->*table_F[(opcode & 0x00FFu)])();
+
+void Chip8System::set_engine(Engine e){
+    engine = e;
+    if(engine == Engine::Jit && !jit) {
+        jit = std::make_unique<::Jit>();
+        if(!jit->available()) {
+            jit.reset();
+            engine = Engine::Cached;
+        } else {
+            jit->set_quirks(quirk_flags(quirks));
+        }
+    }
+    // the jit leans on the decode cache for everything it doesn't compile
+    if(engine != Engine::Interpreter && !decode_cache) {
+        decode_cache = std::make_unique<Instruction[]>(DECODE_CACHE_SIZE);
+    }
+}
+
+uint64_t Chip8System::run_jit_block(uint64_t budget){
+    const ::Jit::Block& block = jit->lookup(pages.get(), program_counter);
+    if(!block.code || block.length > budget) return 0;
+
+    if(!jit_lockstep) {
+        program_counter = block.code(registers, &index_reg, &delay_timer, &sound_timer);
+        opcode = block.last_opcode;
+        idle_poll |= block.polls; // the same gate the handlers set for the other engines
+        return block.length;
+    }
+
+    // lockstep: run the block , rewind , run the same instructions on the interpreter and compare.
+    // blocks never touch memory/display/stack so registers , I , pc and timers are the whole picture
+    uint8_t saved_regs[REGISTERS];
+    std::copy(std::begin(registers), std::end(registers), saved_regs);
+    const uint16_t saved_i = index_reg, saved_pc = program_counter;
+    const uint8_t saved_dt = delay_timer, saved_st = sound_timer;
+
+    const uint16_t jit_pc = block.code(registers, &index_reg, &delay_timer, &sound_timer);
+    uint8_t jit_regs[REGISTERS];
+    std::copy(std::begin(registers), std::end(registers), jit_regs);
+    const uint16_t jit_i = index_reg;
+    const uint8_t jit_dt = delay_timer, jit_st = sound_timer;
+
+    std::copy(std::begin(saved_regs), std::end(saved_regs), registers);
+    index_reg = saved_i;
+    program_counter = saved_pc;
+    delay_timer = saved_dt;
+    sound_timer = saved_st;
+    for(uint8_t i = 0; i < block.length; ++i) execute();
+
+    if(jit_pc != program_counter || jit_i != index_reg || jit_dt != delay_timer || jit_st != sound_timer
+        || !std::equal(std::begin(jit_regs), std::end(jit_regs), std::begin(registers))) {
+        throw std::runtime_error("jit lockstep mismatch in block at pc " + std::to_string(saved_pc));
+    }
+    return block.length;
 }
 
 void Chip8System::load_ROM(char const* romFilename) {
-    std::ifstream ROMContent(romFilename, std::ios::binary | std::ios::ate);  
-    if(!ROMContent) throw std::runtime_error("ROM load failed!");
+    load_ROM(Rom_cache::load(romFilename));
+}
+
+void Chip8System::load_ROM(const uint8_t* data, std::size_t size) {
+    load_ROM(Rom_cache::build(data, size));
+}
+
+void Chip8System::load_ROM(std::shared_ptr<const Rom_image> rom) {
+    map_image(std::move(rom));
+    if(image->rom_size > memory_size - START_ADDRESS) set_quirks(Quirk_profile::Xochip); // only XO-CHIP has room past 4KB
+    clear_decode_cache();
+    dirty_pages = ~0ull;
+#ifdef CHIP8_PROFILE
+    prof.reset();
+#endif
+}
+
+Quirk_profile Chip8System::detect_rom_quirks() const {
+    return image->detected;
+}
+
+void Chip8System::map_image(std::shared_ptr<const Rom_image> boot){
+    ++state_changes;
+    image = std::move(boot);
+    const std::size_t count = memory_size / MEMORY_PAGE_SIZE;
+    if(!pages) pages = std::make_unique<const uint8_t*[]>(count);
+    private_pages.clear();
+    private_pages.resize(count);
+    for(std::size_t p = 0; p < count; ++p) pages[p] = image->page(p);
+}
+
+uint8_t* Chip8System::writable(std::size_t address){
+    address &= memory_size - 1;
+    const std::size_t p = address / MEMORY_PAGE_SIZE;
+    if(!private_pages[p]) {
+        private_pages[p] = std::make_unique<uint8_t[]>(MEMORY_PAGE_SIZE);
+        std::copy(pages[p], pages[p] + MEMORY_PAGE_SIZE, private_pages[p].get());
+        pages[p] = private_pages[p].get();
+    }
+    return &private_pages[p][address % MEMORY_PAGE_SIZE];
+}
+
+void Chip8System::restore_memory(const uint8_t* data){
+    ++state_changes;
+    for(std::size_t p = 0; p < memory_size / MEMORY_PAGE_SIZE; ++p) {
+        const uint8_t* bytes = data + p * MEMORY_PAGE_SIZE;
+        const uint8_t* shared = image->page(p);
+        if(std::equal(bytes, bytes + MEMORY_PAGE_SIZE, shared)) {
+            private_pages[p].reset();
+            pages[p] = shared;
+        } else {
+            std::copy(bytes, bytes + MEMORY_PAGE_SIZE, writable(p * MEMORY_PAGE_SIZE));
+        }
+    }
+}
+
+void Chip8System::resize_memory(std::size_t size){
+    if(size == memory_size) return;
+    const std::size_t count = size / MEMORY_PAGE_SIZE;
+    auto table = std::make_unique<const uint8_t*[]>(count);
+    private_pages.resize(count); // drops the copies past the new end
+    for(std::size_t p = 0; p < count; ++p) table[p] = private_pages[p] ? private_pages[p].get() : image->page(p);
+    pages = std::move(table);
+    memory_size = size;
+    dirty_pages = ~0ull; // the page size changed with it
+}
 
-    long unsigned int size =ROMContent.tellg(); // use last position to get size of total content
-    ROMContent.seekg(0, std::ios::beg);
+Chip8System::State_view Chip8System::view() const {
+    return {opcode, program_counter, index_reg, stack_pointer, delay_timer, sound_timer,
+        std::span<const uint8_t, REGISTERS>(registers), std::span<const uint16_t, STACK_SIZE>(stack), state_changes};
+}
 
-    if((size) > (MEMORY_SIZE - START_ADDRESS)) throw std::runtime_error("ROM too large to run!");
-    ROMContent.read(reinterpret_cast<char*>(&memory[START_ADDRESS]),size);
+void Chip8System::read_memory(std::size_t address, std::span<uint8_t> out) const {
+    if(address + out.size() > memory_size) throw std::runtime_error("memory read out of range");
+    // a page at a time , untouched pages are read straight out of the shared image
+    for(std::size_t done = 0; done < out.size();) {
+        const std::size_t n = std::min(out.size() - done, MEMORY_PAGE_SIZE - (address + done) % MEMORY_PAGE_SIZE);
+        std::copy_n(memory_at(address + done), n, out.begin() + done);
+        done += n;
+    }
 }
 
-Chip8System::Debug_snapshot Chip8System::snapshot(){
-    // capture debugger metrics for current state 
+Chip8System::Debug_snapshot Chip8System::snapshot(std::size_t memory_base) const {
+    // only what the overlay draws: the registers and one memory window , not all of memory
+    const State_view v = view();
     Debug_snapshot snap{};
-    snap.opcode = opcode;
-    snap.pc = program_counter;
-    snap.i = index_reg; 
-    snap.sp = stack_pointer; 
-    snap.dt = delay_timer;
-    snap.st = sound_timer; 
-    std::copy(std::begin(registers), std::end(registers), snap.registers.begin());
-    std::copy(std::begin(stack), std::end(stack), snap.stack.begin());
-    std::copy(std::begin(memory), std::end(memory), snap.memory.begin());
+    snap.opcode = v.opcode;
+    snap.pc = v.pc;
+    snap.i = v.i; 
+    snap.sp = v.sp; 
+    snap.dt = v.dt;
+    snap.st = v.st; 
+    std::copy(v.registers.begin(), v.registers.end(), snap.registers.begin());
+    std::copy(v.stack.begin(), v.stack.end(), snap.stack.begin());
+    snap.memory_base = static_cast<uint16_t>(std::min(memory_base, memory_size - MEMORY_WINDOW));
+    read_memory(snap.memory_base, snap.memory);
+    snap.generation = v.generation;
     return snap; 
 }
 
+const char* Chip8System::fault() const {
+    // only the cases cycle() doesn't guard against , everything else is in range by construction
+    if(awaiting_input || awaiting_release || vblank_wait) return nullptr;
+    if(program_counter + 1u >= memory_size) return "pc out of range";
+    const Quirk_flags flags = quirk_flags(quirks);
+    const uint16_t op = read(program_counter) << 8u | read(program_counter + 1);
+    const uint8_t x = (op & 0x0F00u) >> 8u;
+    const uint8_t y = (op & 0x00F0u) >> 4u;
+    const uint8_t n = op & 0x000Fu;
+    switch(op >> 12u) {
+        case 0x0:
+            if((op & 0x00FFu) == 0xEE && stack_pointer == 0) return "stack underflow";
+            break;
+        case 0x2:
+            if(stack_pointer >= STACK_SIZE) return "stack overflow";
+            break;
+        case 0x5:
+            if(flags.xochip_ops && (n == 0x2 || n == 0x3) && index_reg + (x > y ? x - y : y - x) + 1u > memory_size) {
+                return "register range past end of memory";
+            }
+            break;
+        case 0xD: {
+            // 16x16 sprites are 32 bytes , XO-CHIP reads one sprite per selected plane
+            const unsigned bytes = (flags.schip_ops && n == 0) ? 32u : n;
+            const unsigned planes = flags.xochip_ops ? std::popcount(plane_mask) : 1u;
+            if(index_reg + bytes * planes > memory_size) return "sprite read past end of memory";
+            break;
+        }
+        case 0xE:
+            if((n == 0xE || n == 0x1) && registers[x] >= INPUT_SIZE) return "key index out of range";
+            break;
+        case 0xF:
+            if((op & 0x00FFu) == 0x33 && index_reg + 3u > memory_size) return "BCD store past end of memory";
+            if((op & 0x00FFu) == 0x55 && index_reg + x + 1u > memory_size) return "register store past end of memory";
+            if((op & 0x00FFu) == 0x65 && index_reg + x + 1u > memory_size) return "register load past end of memory";
+            if(op == 0xF000 && flags.xochip_ops && program_counter + 3u >= memory_size) return "pc out of range";
+            break;
+    }
+    return nullptr;
+}
+
+bool Chip8System::halted() const {
+    if(awaiting_input || awaiting_release || program_counter + 1u >= memory_size) return false;
+    const uint16_t op = read(program_counter) << 8u | read(program_counter + 1);
+    return op == (0x1000u | program_counter) || (op == 0x00FD && tables->table_0[0xFD] == &Chip8System::op_00FD);
+}
+
 void Chip8System::reset(){
     // reinitialize the system , essentially wipe the memory and re-costruct but with
     // existing instance
   opcode = 0;
-    std::fill(std::begin(memory), std::end(memory), 0);
+    map_image(image); // the ROM stays loaded , anything written over it is dropped
     std::fill(std::begin(registers), std::end(registers), 0);
+    std::fill(std::begin(flag_registers), std::end(flag_registers), 0);
     std::fill(std::begin(stack), std::end(stack), 0);
-    std::fill(std::begin(display), std::end(display), 0);
+    lores_display = {};
+    if(hires_buffer) *hires_buffer = {};
+    hires_mode = false;
+    plane_mask = 1;
+    mark_display_changed(~0ull);
     std::fill(std::begin(keys), std::end(keys), 0);
     std::fill(std::begin(just_pressed), std::end(just_pressed), 0);
     std::fill(std::begin(just_released), std::end(just_released), 0);
+    clock_cycles = 0;
+    clock_ticks = 0;
+    clock_base_cycle = 0;
+    clock_base_tick = 0;
     stack_pointer = 0;
     index_reg = 0;
     program_counter = START_ADDRESS;
@@ -154,133 +480,172 @@ void Chip8System::reset(){
     sound_timer = 0;
     awaiting_input = false;
     awaiting_release = false;
+    vblank_wait = false;
     wait_reg = 0;
     down_key = 0;
-    for (std::size_t i = 0; i < FONTS_SIZE; ++i) {
-        memory[FONTS_START_ADDRESS + i] = fontset[i];
-    }
     init_tables();
+    clear_decode_cache();
+    dirty_pages = ~0ull;
+#ifdef CHIP8_PROFILE
+    prof.reset();
+#endif
 }
 
 bool Chip8System::sound_active(){
     return sound_timer > 0; 
 }
 
-void Chip8System::op_NULL(){
+uint64_t Chip8System::display_hash() const {
+    // FNV-1a 64-bit , one byte per pixel (its colour) in row-major order so hashes don't depend on the framebuffer layout
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for(std::size_t y = 0 ; y < height(); ++y){
+        for(std::size_t x = 0 ; x < width(); ++x){
+            hash ^= pixel(x, y);
+            hash *= 0x100000001b3ull;
+        }
+    }
+    return hash;
+}
+
+void Chip8System::op_NULL(const Instruction&){
     // do nothing, this is a bad dispatch path (invalid command)
 }
 
-void Chip8System::op_0NNN(){
+void Chip8System::op_0NNN(const Instruction&){
     return; // dud command , we never use this one 
 }
 
-void Chip8System::op_00E0(){
-    std::fill(std::begin(display),std::end(display),0);
+template<class S> S& Chip8System::screen(){
+    if constexpr(std::is_same_v<S, Hires_screen>) return *hires_buffer;
+    else return lores_display;
+}
+
+template<class Q> void Chip8System::skip(){
+    if constexpr(Q::xochip_ops) {
+        if(read(program_counter) == 0xF0 && read(program_counter + 1) == 0x00) program_counter += 2;
+    }
+    program_counter += 2;
+}
+
+template<class S> void Chip8System::op_00E0(const Instruction&){
+    S& target = screen<S>();
+    uint64_t cleared = 0;
+    for(std::size_t p = 0; p < PLANES; ++p) {
+        if(!((plane_mask >> p) & 1u)) continue;
+        for(std::size_t y = 0; y < S::HEIGHT; ++y) {
+            for(uint64_t& word : target.rows[p][y]) {
+                cleared |= static_cast<uint64_t>(word != 0) << y;
+                word = 0;
+            }
+        }
+    }
+    if(cleared) mark_display_changed(cleared); // an already blank screen has nothing to redraw
 } 
 
-void Chip8System::op_00EE(){
+void Chip8System::op_00EE(const Instruction&){
     stack_pointer--; 
     program_counter = stack[stack_pointer]; 
 }
 
-void Chip8System::op_1NNN(){
-    uint16_t address = opcode & 0x0FFFu; // mask out the command bits
+void Chip8System::op_1NNN(const Instruction& ins){
+    uint16_t address = ins.nnn; // mask out the command bits
     program_counter = address; 
 } 
 
-void Chip8System::op_2NNN(){
-    uint16_t address = opcode & 0x0FFFu;
+void Chip8System::op_2NNN(const Instruction& ins){
+    uint16_t address = ins.nnn;
     stack[stack_pointer] = program_counter; // store current pc for subroutine return
     ++stack_pointer;
     program_counter = address; 
 } 
 
-void Chip8System::op_3XNN(){
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // mask non register bits, then shift into proper place 
-    uint8_t NN = opcode & 0x00FFu; 
-    if( registers[Vx] == NN ) program_counter += 2; // increment by 2 to skip an instruction 
+template<class Q> void Chip8System::op_3XNN(const Instruction& ins){
+    uint8_t Vx = ins.x; // mask non register bits, then shift into proper place 
+    uint8_t NN = ins.nn; 
+    if( registers[Vx] == NN ) skip<Q>(); // increment by 2 to skip an instruction 
 } 
 
-void Chip8System::op_4XNN(){
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; 
-    uint8_t NN = opcode & 0x00FFu;
-    if( registers[Vx] != NN ) program_counter += 2;
+template<class Q> void Chip8System::op_4XNN(const Instruction& ins){
+    uint8_t Vx = ins.x; 
+    uint8_t NN = ins.nn;
+    if( registers[Vx] != NN ) skip<Q>();
 }
 
-void Chip8System::op_5XY0(){
-    uint8_t Vx = (opcode & 0x0F00u) >>8u; 
-    uint8_t Vy = (opcode & 0x00F0u) >>4u;
-    if(registers[Vx] == registers[Vy]) program_counter += 2; 
+template<class Q> void Chip8System::op_5XY0(const Instruction& ins){
+    uint8_t Vx = ins.x; 
+    uint8_t Vy = ins.y;
+    if(registers[Vx] == registers[Vy]) skip<Q>(); 
 }
 
-void Chip8System::op_6XNN(){
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; 
-    uint8_t NN = opcode & 0x00FFu;
+void Chip8System::op_6XNN(const Instruction& ins){
+    uint8_t Vx = ins.x; 
+    uint8_t NN = ins.nn;
     registers[Vx] = NN; 
 
 }
 
-void Chip8System::op_7XNN(){
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; 
-    uint8_t NN = opcode & 0x00FFu;
+void Chip8System::op_7XNN(const Instruction& ins){
+    uint8_t Vx = ins.x; 
+    uint8_t NN = ins.nn;
     registers[Vx] += NN; 
 } 
 
-void Chip8System::op_8XY0(){
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; 
-    uint8_t Vy = (opcode & 0x00F0u) >>4u;
+void Chip8System::op_8XY0(const Instruction& ins){
+    uint8_t Vx = ins.x; 
+    uint8_t Vy = ins.y;
     registers[Vx] = registers[Vy]; 
 }
 
-void Chip8System::op_8XY1(){
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; 
-    uint8_t Vy = (opcode & 0x00F0u) >>4u;
+template<class Q> void Chip8System::op_8XY1(const Instruction& ins){
+    uint8_t Vx = ins.x; 
+    uint8_t Vy = ins.y;
     registers[Vx] |= registers[Vy];
-    registers[0xF] = 0; 
+    if constexpr(Q::vf_reset) registers[0xF] = 0; 
 } 
 
-void Chip8System::op_8XY2(){
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; 
-    uint8_t Vy = (opcode & 0x00F0u) >>4u;
+template<class Q> void Chip8System::op_8XY2(const Instruction& ins){
+    uint8_t Vx = ins.x; 
+    uint8_t Vy = ins.y;
     registers[Vx] &= registers[Vy]; 
-    registers[0xF] = 0;
+    if constexpr(Q::vf_reset) registers[0xF] = 0;
 }
 
-void Chip8System::op_8XY3(){
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; 
-    uint8_t Vy = (opcode & 0x00F0u) >>4u;
+template<class Q> void Chip8System::op_8XY3(const Instruction& ins){
+    uint8_t Vx = ins.x; 
+    uint8_t Vy = ins.y;
     registers[Vx] ^= registers[Vy];
-    registers[0xF] = 0;
+    if constexpr(Q::vf_reset) registers[0xF] = 0;
 }
 
-void Chip8System::op_8XY4(){
-    uint8_t Vx = (opcode & 0x0F00u) >>8u; 
-    uint8_t Vy = (opcode & 0x00F0u) >>4u;
+void Chip8System::op_8XY4(const Instruction& ins){
+    uint8_t Vx = ins.x; 
+    uint8_t Vy = ins.y;
     uint16_t ret = registers[Vx] + registers[Vy]; 
     registers[Vx] = ret & 0x00FFu;
     if(ret > 255u) registers[0xF] = 1; // if result of addition is greater than 8 bits , set overflow flag in VF reg
     else registers[0xF] = 0; 
 } 
 
-void Chip8System::op_8XY5(){
-    uint8_t Vx = (opcode & 0x0F00u) >>8u; 
-    uint8_t Vy = (opcode & 0x00F0u) >>4u;
+void Chip8System::op_8XY5(const Instruction& ins){
+    uint8_t Vx = ins.x; 
+    uint8_t Vy = ins.y;
     bool flag = registers[Vx] >= registers[Vy]; 
     registers[Vx] -= registers[Vy];
     if(flag) registers[0xF] = 1; 
     else registers[0xF] = 0; 
 }
 
-void Chip8System::op_8XY6(){
-      uint8_t Vx = (opcode & 0x0F00u) >>8u; 
-      uint16_t flag = (registers[Vx] & 0x001u);
-      registers[Vx] >>= 1 ; 
+template<class Q> void Chip8System::op_8XY6(const Instruction& ins){
+      uint8_t Vx = ins.x; 
+      const uint8_t src = Q::shift_vy ? registers[ins.y] : registers[Vx]; // VIP shifts Vy into Vx
+      uint16_t flag = (src & 0x001u);
+      registers[Vx] = src >> 1 ; 
       registers[0xF] = flag;
 }
 
-void Chip8System::op_8XY7(){
-    uint8_t Vx = (opcode & 0x0F00u) >>8u; 
-    uint8_t Vy = (opcode & 0x00F0u) >>4u;
+void Chip8System::op_8XY7(const Instruction& ins){
+    uint8_t Vx = ins.x; 
+    uint8_t Vy = ins.y;
     bool flag = (registers[Vy] >= registers[Vx]);
     registers[Vx] = registers[Vy] - registers[Vx];
     if(flag) registers[0xF] = 1; 
@@ -288,83 +653,120 @@ void Chip8System::op_8XY7(){
     
 }
 
-void Chip8System::op_8XYE(){
-      uint8_t Vx = (opcode & 0x0F00u) >>8u; 
-      uint16_t flag = (registers[Vx] & 0x80u) >> 7u;
-      registers[Vx] <<= 1 ; 
+template<class Q> void Chip8System::op_8XYE(const Instruction& ins){
+      uint8_t Vx = ins.x; 
+      const uint8_t src = Q::shift_vy ? registers[ins.y] : registers[Vx];
+      uint16_t flag = (src & 0x80u) >> 7u;
+      registers[Vx] = static_cast<uint8_t>(src << 1) ; 
       registers[0xF] = flag;
 }
 
-void Chip8System::op_9XY0(){
-    uint8_t Vx = (opcode & 0x0F00u) >>8u; 
-    uint8_t Vy = (opcode & 0x00F0u) >>4u;
-    if(registers[Vx] != registers[Vy]) program_counter += 2; 
+template<class Q> void Chip8System::op_9XY0(const Instruction& ins){
+    uint8_t Vx = ins.x; 
+    uint8_t Vy = ins.y;
+    if(registers[Vx] != registers[Vy]) skip<Q>(); 
 } 
 
-void Chip8System::op_ANNN(){
-    uint16_t addr = opcode & 0x0FFFu; 
+void Chip8System::op_ANNN(const Instruction& ins){
+    uint16_t addr = ins.nnn; 
     index_reg = addr; 
 } 
 
-void Chip8System::op_BNNN(){
-    uint16_t addr = opcode & 0x0FFFu;
-    program_counter = registers[0] + addr;  
+template<class Q> void Chip8System::op_BNNN(const Instruction& ins){
+    uint16_t addr = ins.nnn;
+    program_counter = registers[Q::jump_vx ? ins.x : 0] + addr; // CHIP-48 read BXNN as XNN + VX
 } 
 
-void Chip8System::op_CXNN(){
-     uint8_t Vx = (opcode & 0x0F00u) >>8u; 
-     uint8_t NN = opcode & 0x00FFu; 
+void Chip8System::op_CXNN(const Instruction& ins){
+     uint8_t Vx = ins.x; 
+     uint8_t NN = ins.nn; 
 
-     uint8_t random_value = byte_dist(rng);
+     uint8_t random_value = rng.next_byte();
+     ++rng_draws;
      registers[Vx] = random_value & NN; 
 }
 
-void Chip8System::op_DXYN(){
-    uint8_t Vx = (opcode & 0x0F00u) >>8u; 
-    uint8_t Vy = (opcode & 0x00F0u) >>4u;
-    uint8_t height = opcode & 0x000Fu; 
+template<class Q, class S> void Chip8System::op_DXYN(const Instruction& ins){
+    uint8_t Vx = ins.x; 
+    uint8_t Vy = ins.y;
+    // SUPER-CHIP DXY0 draws 16x16 , two bytes per row
+    const bool wide = Q::schip_ops && ins.n == 0;
+    const unsigned height = wide ? 16u : ins.n;
     
     // handle wrapping when start goes over screen boundaries
-    const uint8_t X_START = registers[Vx] % VIDEO_W; 
-    const uint8_t Y_START = registers[Vy] % VIDEO_H; 
-    registers[0xF] = 0; 
+    const unsigned X_START = registers[Vx] % S::WIDTH; 
+    const unsigned Y_START = registers[Vy] % S::HEIGHT; 
+    S& target = screen<S>();
+    uint64_t collision = 0;
+    uint64_t touched = 0;
     
-    // iterate over each sprite row to build n height (byte)
-    for(unsigned int i = 0 ; i < height ; ++i){
-        const uint8_t sprite_block = memory[index_reg + i]; 
-        const uint8_t y = (Y_START + i) % VIDEO_H; // wrap by pixel
-        
-        // iterate over each pixel in the row
-        for(uint8_t j = 0 ; j < 8 ; ++j){
-            const bool isOn = (sprite_block & (0x80u >> j)) != 0; 
-            if(!isOn) continue; 
-            const uint8_t x = (X_START + j) % VIDEO_W;
-            uint32_t& pixel = display[y * VIDEO_W + x]; 
-            if(pixel == 0xFFFFFFFFu) registers[0xF] = 1 ; // set collision
-            pixel ^= 0xFFFFFFFFu; // XOR to flip the current state 
+    // each sprite row is one byte (two when wide) , line it up with x in a row word (rotate wraps pixels past the
+    // right edge). clipping profiles cut the sprite at the right and bottom edges instead
+    auto draw_plane = [&](std::size_t plane, uint16_t address) {
+        for(unsigned int i = 0 ; i < height ; ++i){
+            if(Q::clip_sprites && Y_START + i >= S::HEIGHT) break;
+            const uint64_t bits = wide
+                ? static_cast<uint64_t>(read(address + 2 * i) << 8u | read(address + 2 * i + 1)) << 48
+                : static_cast<uint64_t>(read(address + i)) << 56;
+            const unsigned int y = (Y_START + i) % S::HEIGHT; // wrap by pixel
+            uint64_t* row = target.rows[plane][y];
+            uint64_t drawn = 0;
+            if constexpr(S::WORDS == 1) {
+                const uint64_t sprite = Q::clip_sprites ? bits >> X_START : std::rotr(bits, X_START);
+                collision |= row[0] & sprite;
+                row[0] ^= sprite; // XOR to flip the current state 
+                drawn = sprite;
+            } else {
+                // 128 pixel row as two words , the sprite lands in one or straddles both
+                uint64_t left = X_START < 64 ? bits >> X_START : 0;
+                uint64_t right = X_START == 0 ? 0 : X_START < 64 ? bits << (64 - X_START) : bits >> (X_START - 64);
+                if(!Q::clip_sprites && X_START > 64) left = bits << (128 - X_START); // the part past the right edge wraps
+                collision |= (row[0] & left) | (row[1] & right);
+                row[0] ^= left;
+                row[1] ^= right;
+                drawn = left | right;
+            }
+            touched |= static_cast<uint64_t>(drawn != 0) << y;
         }
+    };
+    if constexpr(Q::xochip_ops) {
+        // one sprite per selected plane , back to back in memory
+        uint16_t address = index_reg;
+        for(std::size_t p = 0; p < PLANES; ++p) {
+            if(!((plane_mask >> p) & 1u)) continue;
+            draw_plane(p, address);
+            address += height * (wide ? 2u : 1u);
+        }
+    } else {
+        draw_plane(0, index_reg);
     }
+    registers[0xF] = collision != 0;
+    if(touched) mark_display_changed(touched);
+    if constexpr(Q::display_wait) vblank_wait = true;
 }
 
-void Chip8System::op_EX9E(){
-     uint8_t Vx = (opcode & 0x0F00u) >>8u;
+template<class Q> void Chip8System::op_EX9E(const Instruction& ins){
+     uint8_t Vx = ins.x;
      uint8_t key = registers[Vx]; 
-     if(keys[key]) program_counter += 2 ; 
+     idle_poll = true;
+     if(keys[key]) skip<Q>() ; 
 }
 
-void Chip8System::op_EXA1(){
-     uint8_t Vx = (opcode & 0x0F00u) >>8u;
+template<class Q> void Chip8System::op_EXA1(const Instruction& ins){
+     uint8_t Vx = ins.x;
      uint8_t key = registers[Vx]; 
-     if(!keys[key]) program_counter += 2 ; 
+     idle_poll = true;
+     if(!keys[key]) skip<Q>() ; 
 }
 
-void Chip8System::op_FX07(){
-     uint8_t Vx = (opcode & 0x0F00u) >>8u;
+void Chip8System::op_FX07(const Instruction& ins){
+     uint8_t Vx = ins.x;
      registers[Vx] = delay_timer;
+     idle_poll = true;
 }
 
-void Chip8System::op_FX0A(){
-    uint8_t Vx = (opcode & 0x0F00u) >>8u;
+void Chip8System::op_FX0A(const Instruction& ins){
+    uint8_t Vx = ins.x;
     bool found = false; 
     for(uint8_t i = 0 ; i < 16; ++i){
         if(just_pressed[i]) {
@@ -379,54 +781,205 @@ void Chip8System::op_FX0A(){
     }
 }
 
-void Chip8System::op_FX15(){
-    uint8_t Vx = (opcode & 0x0F00u) >>8u;
+void Chip8System::op_FX15(const Instruction& ins){
+    uint8_t Vx = ins.x;
     delay_timer = registers[Vx]; 
 } 
 
-void Chip8System::op_FX18(){
-    uint8_t Vx = (opcode & 0x0F00u) >>8u;
+void Chip8System::op_FX18(const Instruction& ins){
+    uint8_t Vx = ins.x;
     sound_timer = registers[Vx];
 }
 
-void Chip8System::op_FX1E(){
-    uint8_t Vx = (opcode & 0x0F00u) >>8u; 
+void Chip8System::op_FX1E(const Instruction& ins){
+    uint8_t Vx = ins.x; 
     index_reg += registers[Vx]; 
 }
 
-void Chip8System::op_FX29(){
-    uint8_t Vx = (opcode & 0x0F00u) >>8u;
+void Chip8System::op_FX29(const Instruction& ins){
+    uint8_t Vx = ins.x;
     uint8_t dig = registers[Vx]; 
     // use font start and offset to find first byte of target
     index_reg = FONTS_START_ADDRESS + (5*dig); 
 }
 
-void Chip8System::op_FX33(){
-    uint8_t Vx = (opcode & 0x0F00u) >>8u;
+void Chip8System::op_FX33(const Instruction& ins){
+    uint8_t Vx = ins.x;
     uint8_t val = registers[Vx]; 
-    memory[index_reg + 2] = val % 10;
+    *writable(index_reg + 2) = val % 10;
     val /= 10; 
-    memory[index_reg + 1] = val % 10;
+    *writable(index_reg + 1) = val % 10;
     val /= 10;
-    memory[index_reg] = val % 10; 
+    *writable(index_reg) = val % 10; 
     val /=10; 
+    invalidate_code(index_reg, 3);
+    mark_dirty(index_reg, 3);
 }
 
-void Chip8System::op_FX55(){
-    uint8_t Vx = (opcode & 0x0F00u) >>8u;
+template<class Q> void Chip8System::op_FX55(const Instruction& ins){
+    uint8_t Vx = ins.x;
     for(uint8_t i = 0 ; i <= Vx; ++i){
-        memory[index_reg + i] = registers[i]; 
+        *writable(index_reg + i) = registers[i]; 
     }
+    invalidate_code(index_reg, ins.x + 1u);
+    mark_dirty(index_reg, ins.x + 1u);
+    if constexpr(Q::index_increment == Index_increment::By_x) index_reg += Vx;
+    if constexpr(Q::index_increment == Index_increment::By_x_plus_1) index_reg += Vx + 1u;
 }
 
-void Chip8System::op_FX65(){
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+template<class Q> void Chip8System::op_FX65(const Instruction& ins){
+    uint8_t Vx = ins.x;
     for(uint8_t i = 0 ; i <= Vx ; ++i){
-        registers[i] = memory[index_reg + i]; 
+        registers[i] = read(index_reg + i); 
     }
+    if constexpr(Q::index_increment == Index_increment::By_x) index_reg += Vx;
+    if constexpr(Q::index_increment == Index_increment::By_x_plus_1) index_reg += Vx + 1u;
+}
+
+template<class Q, class S> void Chip8System::fused_ANNN_DXYN(const Instruction& ins){
+    op_ANNN(ins);
+    op_DXYN<Q, S>((&ins)[2]);
+}
+
+void Chip8System::fused_6XNN_6XNN(const Instruction& ins){
+    op_6XNN(ins);
+    op_6XNN((&ins)[2]);
+}
+
+template<class Q> void Chip8System::fused_FX07_3XNN(const Instruction& ins){
+    registers[ins.x] = delay_timer;
+    idle_poll = true;
+    if(delay_timer == (&ins)[2].nn) skip<Q>();
+}
+
+template<class Q> void Chip8System::fused_7XNN_3XNN(const Instruction& ins){
+    registers[ins.x] += ins.nn;
+    if(registers[ins.x] == (&ins)[2].nn) skip<Q>();
+}
+
+template<class S> void Chip8System::op_00CN(const Instruction& ins){
+    // rows pushed off the bottom are gone , blank rows come in at the top
+    S& target = screen<S>();
+    const std::size_t n = ins.n;
+    for(std::size_t p = 0; p < PLANES; ++p) {
+        if(!((plane_mask >> p) & 1u)) continue;
+        std::memmove(target.rows[p][n], target.rows[p][0], (S::HEIGHT - n) * sizeof(target.rows[p][0]));
+        std::memset(target.rows[p][0], 0, n * sizeof(target.rows[p][0]));
+    }
+    mark_display_changed(all_rows<S>());
+}
+
+template<class S> void Chip8System::op_00DN(const Instruction& ins){
+    S& target = screen<S>();
+    const std::size_t n = ins.n;
+    for(std::size_t p = 0; p < PLANES; ++p) {
+        if(!((plane_mask >> p) & 1u)) continue;
+        std::memmove(target.rows[p][0], target.rows[p][n], (S::HEIGHT - n) * sizeof(target.rows[p][0]));
+        std::memset(target.rows[p][S::HEIGHT - n], 0, n * sizeof(target.rows[p][0]));
+    }
+    mark_display_changed(all_rows<S>());
+}
+
+template<class S> void Chip8System::op_00FB(const Instruction&){
+    // 4 pixels right across the row's words , whatever leaves the right edge is dropped
+    S& target = screen<S>();
+    for(std::size_t p = 0; p < PLANES; ++p) {
+        if(!((plane_mask >> p) & 1u)) continue;
+        for(uint64_t (&row)[S::WORDS] : target.rows[p]) {
+            uint64_t carry = 0;
+            for(uint64_t& word : row) {
+                const uint64_t old = word;
+                word = old >> 4 | carry;
+                carry = old << 60;
+            }
+        }
+    }
+    mark_display_changed(all_rows<S>());
+}
+
+template<class S> void Chip8System::op_00FC(const Instruction&){
+    S& target = screen<S>();
+    for(std::size_t p = 0; p < PLANES; ++p) {
+        if(!((plane_mask >> p) & 1u)) continue;
+        for(uint64_t (&row)[S::WORDS] : target.rows[p]) {
+            uint64_t carry = 0;
+            for(std::size_t w = S::WORDS; w-- > 0;) {
+                const uint64_t old = row[w];
+                row[w] = old << 4 | carry;
+                carry = old >> 60;
+            }
+        }
+    }
+    mark_display_changed(all_rows<S>());
+}
+
+void Chip8System::op_00FD(const Instruction&){
+    program_counter -= 2; // nothing to return to , sit on the exit like a 1NNN halt
+}
+
+void Chip8System::op_00FE(const Instruction&){
+    set_resolution(false);
+}
+
+void Chip8System::op_00FF(const Instruction&){
+    set_resolution(true);
+}
+
+void Chip8System::set_resolution(bool hires){
+    // both interpreters clear the screen on a mode switch
+    lores_display = {};
+    *hires_buffer = {}; // only SUPER-CHIP profiles have 00FE/00FF
+    mark_display_changed(~0ull);
+    if(hires == hires_mode) return;
+    hires_mode = hires;
+    init_tables();
+    clear_decode_cache(); // decoded DXYN / scroll / CLS handlers belong to the old resolution
+}
+
+void Chip8System::op_FX30(const Instruction& ins){
+    index_reg = BIG_FONTS_START_ADDRESS + 10 * (registers[ins.x] & 0xFu);
+}
+
+void Chip8System::op_FX75(const Instruction& ins){
+    std::copy(registers, registers + ins.x + 1, flag_registers);
+}
+
+void Chip8System::op_FX85(const Instruction& ins){
+    std::copy(flag_registers, flag_registers + ins.x + 1, registers);
+}
+
+void Chip8System::op_5XY2(const Instruction& ins){
+    // Vx first , counting down when x > y
+    const int step = ins.x <= ins.y ? 1 : -1;
+    const std::size_t count = (ins.x <= ins.y ? ins.y - ins.x : ins.x - ins.y) + 1u;
+    for(std::size_t i = 0; i < count; ++i) *writable(static_cast<uint16_t>(index_reg + i)) = registers[ins.x + step * static_cast<int>(i)];
+    invalidate_code(index_reg, count);
+    mark_dirty(index_reg, count);
+}
+
+void Chip8System::op_5XY3(const Instruction& ins){
+    const int step = ins.x <= ins.y ? 1 : -1;
+    const std::size_t count = (ins.x <= ins.y ? ins.y - ins.x : ins.x - ins.y) + 1u;
+    for(std::size_t i = 0; i < count; ++i) registers[ins.x + step * static_cast<int>(i)] = read(static_cast<uint16_t>(index_reg + i));
+}
+
+void Chip8System::op_F000(const Instruction&){
+    // pc is already past the F000 , the address is the next word
+    index_reg = read(program_counter) << 8u | read(program_counter + 1);
+    program_counter += 2;
+}
+
+void Chip8System::op_FN01(const Instruction& ins){
+    plane_mask = ins.x & 0x3u;
 }
 
 void Chip8System::cycle() {
+    ++state_changes;
+    if(tracer) traced_execute();
+    else execute();
+}
+
+void Chip8System::execute() {
     // handle suspension state for op_FX0A
     if(awaiting_input) {
         for(uint8_t i = 0 ; i < REGISTERS; ++i){
@@ -445,17 +998,280 @@ void Chip8System::cycle() {
             awaiting_release = false; 
        }
     }
+    else if(vblank_wait){
+        // display_wait profiles hold the cpu after a draw until tick_timers()
+    }
     else{
         // 2 8-bit addresses to 16-bit instruction
-        opcode = (memory[program_counter] << 8u | memory[program_counter+1]); 
+        opcode = fetch(program_counter); 
+#ifdef CHIP8_PROFILE
+        prof.record(program_counter, opcode);
+#endif
         program_counter += 2 ;
-        dispatch();
+        dispatch(decode(opcode));
+    }
+}
+
+uint64_t Chip8System::run(uint64_t budget){
+    uint64_t done = 0;
+    ++state_changes;
+    if(breaks) breaks->clear_hit();
+    if(breaks && breaks->armed()) return run_checked(budget);
+    if(tracer) return run_traced(budget);
+#ifdef CHIP8_PROFILE
+    // the cached and jit engines skip cycle() , so profiling builds interpret everything
+    for(; done < budget; ++done) execute();
+    return done;
+#endif
+    idle_armed = false; // a loop has to come around three times inside this budget to count
+    idle_poll = false;
+    const bool try_idle = idle_skip && budget >= IDLE_MIN_BUDGET;
+    if(engine == Engine::Interpreter) {
+        while(done < budget) {
+            if(awaiting_input || awaiting_release || vblank_wait) {
+                const bool was_input = awaiting_input;
+                const bool was_release = awaiting_release;
+                execute();
+                ++done;
+                if(awaiting_input == was_input && awaiting_release == was_release) return budget;
+                continue;
+            }
+            const uint16_t from = program_counter;
+            execute();
+            ++done;
+            if(idle_poll && program_counter <= from && try_idle) done += skip_idle(done, budget);
+        }
+        return done;
+    }
+
+    while(done < budget) {
+        if(awaiting_input || awaiting_release || vblank_wait) {
+            const bool was_input = awaiting_input;
+            const bool was_release = awaiting_release;
+            execute();
+            ++done;
+            // key edges and the vblank can't arrive mid-run , so a wait that didn't advance burns the rest of the budget
+            if(awaiting_input == was_input && awaiting_release == was_release) return budget;
+            continue;
+        }
+        // out of range pcs and a fused pair that doesn't fit the budget go through cycle()
+        if(program_counter + 1u >= MEMORY_SIZE) {
+            execute();
+            ++done;
+            continue;
+        }
+        if(engine == Engine::Jit) {
+            const uint16_t from = program_counter;
+            const uint64_t ran = run_jit_block(budget - done);
+            if(ran) {
+                done += ran;
+                if(idle_poll && program_counter <= from && try_idle) done += skip_idle(done, budget);
+                continue;
+            }
+        }
+        Instruction* ins = &decode_cache[program_counter];
+        if(!ins->handler) ins = &decode_at(program_counter);
+        if(ins->length > budget - done) {
+            execute();
+            ++done;
+            continue;
+        }
+        const uint16_t from = program_counter;
+        opcode = ins->opcode;
+        program_counter += 2 * ins->length;
+        (this->*ins->handler)(*ins);
+        done += ins->length;
+        if(idle_poll && program_counter <= from && try_idle) done += skip_idle(done, budget);
+    }
+    return done;
+}
+
+uint64_t Chip8System::idle_fingerprint() const {
+    // only a filter , equal prints still go through the full probe before anything is skipped
+    uint64_t regs[2];
+    std::memcpy(regs, registers, sizeof(regs));
+    uint64_t h = static_cast<uint64_t>(program_counter) << 48 | static_cast<uint64_t>(index_reg) << 32
+        | static_cast<uint64_t>(stack_pointer) << 16 | static_cast<uint64_t>(delay_timer) << 8 | sound_timer;
+    h = (h ^ regs[0]) * 0x9E3779B97F4A7C15ull;
+    h = (h ^ regs[1]) * 0xC2B2AE3D27D4EB4Full;
+    return h ^ (display_generation + memory_writes + rng_draws);
+}
+
+uint64_t Chip8System::skip_idle(uint64_t done, uint64_t budget){
+    idle_poll = false; // the next lap has to poll again to be checked
+    // most backward jumps after a poll are loops that changed something , the fingerprint turns those away
+    // without copying the whole probe
+    const uint64_t print = idle_fingerprint();
+    if(!idle_armed || print != idle_print) {
+        idle_print = print;
+        idle_at = done;
+        idle_armed = true;
+        idle_probed = false;
+        return 0;
+    }
+
+    Idle_probe now;
+    now.pc = program_counter;
+    now.i = index_reg;
+    now.sp = stack_pointer;
+    now.dt = delay_timer;
+    now.st = sound_timer;
+    now.awaiting_input = awaiting_input;
+    now.awaiting_release = awaiting_release;
+    now.down_key = down_key;
+    now.wait_reg = wait_reg;
+    now.rng_draws = rng_draws;
+    now.display_generation = display_generation;
+    now.memory_writes = memory_writes;
+    std::copy(std::begin(registers), std::end(registers), now.registers);
+    std::copy(std::begin(stack), std::end(stack), now.stack);
+
+    if(!idle_probed || !(now == idle_probe)) {
+        // the fingerprint repeated , take the exact state here and skip once the next lap matches it byte for byte
+        idle_probe = now;
+        idle_at = done;
+        idle_probed = true;
+        return 0;
     }
+    // keys and timers only change between run() calls , so the lap from idle_at repeats exactly.
+    // skip whole laps only , the tail runs normally so we stop at the same mid-loop pc as real execution
+    const uint64_t lap = done - idle_at;
+    const uint64_t skipped = (budget - done) / lap * lap;
+    idle_elided += skipped;
+    idle_at = done + skipped;
+    return skipped;
 }
 
 void Chip8System::tick_timers() {
+    ++state_changes;
     if(delay_timer > 0) --delay_timer;
     if(sound_timer > 0) --sound_timer;
+    vblank_wait = false;
+}
+
+void Chip8System::set_quirks(Quirk_profile profile){
+    const Quirk_flags flags = quirk_flags(profile);
+    if(!flags.xochip_ops && image->rom_size > MEMORY_SIZE - START_ADDRESS) throw std::runtime_error("ROM only fits XO-CHIP's 64KB memory");
+    quirks = profile;
+    vblank_wait = false;
+    ++state_changes;
+    resize_memory(flags.xochip_ops ? XO_MEMORY_SIZE : MEMORY_SIZE);
+    if(!flags.xochip_ops) plane_mask = 1;
+    if(!flags.schip_ops && hires_mode) {
+        hires_mode = false;
+        mark_display_changed(~0ull);
+    }
+    if(flags.schip_ops && !hires_buffer) hires_buffer = std::make_unique<Hires_screen>();
+    else if(!flags.schip_ops) hires_buffer.reset();
+    init_tables();
+    clear_decode_cache(); // cached handlers and compiled blocks belong to the old profile
+    if(jit) jit->set_quirks(quirk_flags(quirks));
+}
+
+void Chip8System::set_cpu_hz(uint64_t hz){
+    if(hz == 0) throw std::runtime_error("cpu speed must be greater than 0");
+    rebase_clock();
+    fixed_hz = hz;
+}
+
+void Chip8System::set_timing(Timing t){
+    rebase_clock();
+    timing = t;
+}
+
+void Chip8System::rebase_clock(){
+    // the frame in progress keeps its start , only the boundaries after it move to the new speed
+    clock_base_cycle += ((clock_ticks - clock_base_tick) * clock_hz()) / TIMER_HZ;
+    clock_base_tick = clock_ticks;
+}
+
+void Chip8System::seek_ticks(uint64_t ticks){
+    clock_ticks = ticks;
+    clock_base_tick = 0;
+    clock_base_cycle = 0;
+    clock_cycles = (ticks * clock_hz()) / TIMER_HZ;
+}
+
+uint64_t Chip8System::run_until(uint64_t target){
+    uint64_t done = 0;
+    for(;;) {
+        const uint64_t tick_at = next_tick_cycle();
+        if(clock_cycles >= tick_at) {
+            // one tick per pass , below 60Hz several boundaries can share a cycle and each is its own frame
+            tick_timers();
+            ++clock_ticks;
+            if(clock_cycles >= target) return done;
+            continue;
+        }
+        if(clock_cycles >= target) return done;
+        const uint64_t stop = std::min(target, tick_at);
+        if(timing == Timing::Vip) {
+            done += run_vip(stop);
+        } else {
+            const uint64_t ran = run(stop - clock_cycles);
+            clock_cycles += ran;
+            done += ran;
+        }
+        if(break_pending()) return done; // mid-frame , the next call picks the frame up where it stopped
+    }
+}
+
+uint64_t Chip8System::run_vip(uint64_t stop){
+    uint64_t done = 0;
+    ++state_changes;
+    const bool checked = breaks && breaks->armed();
+    if(breaks) breaks->clear_hit();
+    while(clock_cycles < stop) {
+        if(checked && !awaiting_input && !awaiting_release && !vblank_wait && at_break()) break;
+        const uint16_t op = program_counter + 1u < MEMORY_SIZE ? (read(program_counter) << 8) | read(program_counter + 1) : 0;
+        if(tracer) traced_execute();
+        else execute();
+        ++done;
+        // a wait that didn't finish can't change before the next key edge or tick , which only land between calls
+        if(awaiting_input || awaiting_release || vblank_wait) {
+            clock_cycles = stop;
+            break;
+        }
+        clock_cycles += vip_cycles(op);
+    }
+    return done;
+}
+
+uint32_t Chip8System::vip_cycles(uint16_t op){
+    // approximate machine cycles of the VIP interpreter routines plus its 40 cycle fetch/decode. skips are
+    // costed as not taken and DXYN/00E0 leave out the wait for the display interrupt
+    constexpr uint32_t FETCH = 40;
+    const uint32_t x = (op >> 8) & 0xF;
+    const uint32_t n = op & 0xF;
+    switch(op >> 12) {
+        case 0x0:
+            if(op == 0x00E0) return FETCH + 3078;
+            if(op == 0x00EE) return FETCH + 10;
+            return FETCH + 26; // 0NNN machine code call
+        case 0x1: return FETCH + 12;
+        case 0x2: return FETCH + 26;
+        case 0x3:
+        case 0x4: return FETCH + 10;
+        case 0x5:
+        case 0x9: return FETCH + 14;
+        case 0x6: return FETCH + 6;
+        case 0x7: return FETCH + 10;
+        case 0x8: return FETCH + 44;
+        case 0xA: return FETCH + 12;
+        case 0xB: return FETCH + 22;
+        case 0xC: return FETCH + 36;
+        case 0xD: return FETCH + 26 + 46 * n;
+        case 0xE: return FETCH + 14;
+        default:
+            switch(op & 0xFF) {
+                case 0x1E: return FETCH + 16;
+                case 0x29: return FETCH + 16;
+                case 0x33: return FETCH + 84;
+                case 0x55:
+                case 0x65: return FETCH + 14 + 14 * (x + 1);
+                default: return FETCH + 10; // FX07 , FX0A , FX15 , FX18
+            }
+    }
 }
 
 
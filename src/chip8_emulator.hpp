@@ -1,28 +1,97 @@
 #pragma once 
 
 #include <cstdint> 
-#include <random>
+#include <cstddef>
 #include <array>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "breakpoints.hpp"
+#include "quirks.hpp"
+#include "rng.hpp"
+#include "trace.hpp"
+
+#ifdef CHIP8_PROFILE
+#include "profiler.hpp"
+#endif
+
+class Jit;
+class Aot_runtime;
+struct Rom_image;
 
 class Chip8System {
     public: 
         static constexpr std::size_t INPUT_SIZE = 16;  // chip 8 uses 16 input keys corresponding to the first 16 hex values 0 - F(15)
-        static constexpr std::size_t MEMORY_SIZE = 4096; // chip 8 has 4k memory , so 4096 bytes
+        static constexpr std::size_t MEMORY_SIZE = 4096; // chip 8 has 4k memory , so 4096 bytes. also the code space the decode cache and jit cover
+        static constexpr std::size_t XO_MEMORY_SIZE = 65536; // XO-CHIP reaches 64KB through I (F000 NNNN)
         static constexpr std::size_t REGISTERS = 16; // 16 registers in original design
+        static constexpr std::size_t FLAG_REGISTERS = 16; // SUPER-CHIP FX75/FX85 storage (8 on the HP-48 , 16 on XO-CHIP)
         static constexpr std::size_t STACK_SIZE = 16; 
         static constexpr std::size_t VIDEO_H = 32; 
         static constexpr std::size_t VIDEO_W = 64;  
+        static constexpr std::size_t HIRES_H = 64; // SUPER-CHIP / XO-CHIP 00FF mode
+        static constexpr std::size_t HIRES_W = 128;
+        static constexpr std::size_t PLANES = 2; // XO-CHIP bitplanes , everything else only draws on plane 0
         static constexpr std::size_t FONTS_SIZE = 80; 
+        static constexpr std::size_t BIG_FONTS_SIZE = 160; // SUPER-CHIP 8x10 digits (0-F , XO-CHIP added A-F)
         static constexpr std::size_t F_TABLE_SIZE = 256; // F table needs full byte to distinguish commands
         static constexpr std::size_t FONTS_START_ADDRESS = 0x050 ; // font set was originally stored 0x050 - 0x0A0
+        static constexpr std::size_t BIG_FONTS_START_ADDRESS = 0x0A0; // right after the small font
         static constexpr std::size_t START_ADDRESS = 0x200;
+        static constexpr std::size_t MEMORY_PAGE_SIZE = 256; // copy-on-write granularity of memory shared with the ROM image
+        static constexpr std::size_t MEMORY_WINDOW = 64; // bytes of memory a Debug_snapshot carries , one viewer page
 
-        uint32_t display[VIDEO_W * VIDEO_H]{}; // display window 64 x 32 pixels (32 bit pixels) 
+        // framebuffer for one resolution: PLANES bitplanes of H rows , W / 64 words per row , bit 63 of word 0 is x = 0
+        template<std::size_t W, std::size_t H> struct Screen {
+            static constexpr std::size_t WIDTH = W;
+            static constexpr std::size_t HEIGHT = H;
+            static constexpr std::size_t WORDS = W / 64;
+            uint64_t rows[PLANES][H][WORDS]{};
+            uint8_t pixel(std::size_t x, std::size_t y) const {
+                uint8_t colour = 0;
+                for(std::size_t p = 0; p < PLANES; ++p) colour |= ((rows[p][y][x / 64] >> (63 - x % 64)) & 1u) << p;
+                return colour;
+            }
+        };
+        using Lores_screen = Screen<VIDEO_W, VIDEO_H>;
+        using Hires_screen = Screen<HIRES_W, HIRES_H>;
+        // each resolution has its own buffer (and its own DXYN / scroll handlers) , so the 64x32 path stays one word per row.
+        // the 2KB hires one only exists while the profile has schip_ops
+        Lores_screen lores_display{};
+        const Hires_screen& hires_display() const {return *hires_buffer;}
+        bool hires() const {return hires_mode;}
+        std::size_t width() const {return hires_mode ? HIRES_W : VIDEO_W;}
+        std::size_t height() const {return hires_mode ? HIRES_H : VIDEO_H;}
+        // colour index at (x , y) in the current resolution , bit p set when plane p is lit
+        uint8_t pixel(std::size_t x, std::size_t y) const {return hires_mode ? hires_buffer->pixel(x, y) : lores_display.pixel(x, y);}
+        // bumped whenever DXYN/00E0 (or reset/load_state) actually change the display , so frontends can skip idle frames
+        uint64_t frame_generation() const {return display_generation;}
+        uint64_t dirty_rows() const {return dirty_row_mask;} // one bit per display row changed since clear_dirty_rows()
+        void clear_dirty_rows() {dirty_row_mask = 0;}
         uint8_t keys[REGISTERS]{};
         uint8_t just_pressed[REGISTERS]{};
         uint8_t just_released[REGISTERS]{};
         uint8_t down_key{};
 
+        // read-only view of the live machine , nothing is copied. the spans point into the VM , read them on the thread
+        // driving it and before it runs again. generation moves whenever anything shown here (or memory) may have changed
+        struct State_view {
+            uint16_t opcode{}, pc{}, i{};
+            uint8_t sp{}, dt{}, st{};
+            std::span<const uint8_t, REGISTERS> registers;
+            std::span<const uint16_t, STACK_SIZE> stack;
+            uint64_t generation{};
+        };
+        State_view view() const;
+        uint64_t state_generation() const {return state_changes;} // bumped by every call that can run or replace the VM
+        std::size_t memory_bytes() const {return memory_size;}
+        // memory in MEMORY_PAGE_SIZE pages , shared with the ROM image until written
+        std::span<const uint8_t, MEMORY_PAGE_SIZE> memory_page(std::size_t page) const {return std::span<const uint8_t, MEMORY_PAGE_SIZE>(pages[page], MEMORY_PAGE_SIZE);}
+        void read_memory(std::size_t address, std::span<uint8_t> out) const; // just out.size() bytes , may cross pages
+
+        // what the debug overlay shows , small enough to hand to another thread every frame. memory is only the
+        // MEMORY_WINDOW bytes the memory viewer has on screen
         struct Debug_snapshot {
         uint16_t opcode{};  
         uint8_t sp{}; 
@@ -32,88 +101,319 @@ class Chip8System {
         uint8_t st{}; 
         std::array<uint8_t, REGISTERS> registers{};
         std::array<uint16_t, STACK_SIZE> stack{};
-        std::array<uint8_t, MEMORY_SIZE> memory{};
+        uint16_t memory_base{}; // clamped so the window fits in memory
+        std::array<uint8_t, MEMORY_WINDOW> memory{};
+        uint64_t generation{}; // state_generation() it was taken at
         };
         
-        Chip8System();
-        void load_ROM(const char* path); 
+        // execution engine used by run() , cycle() is always the plain table interpreter
+        enum class Engine : uint8_t {
+            Interpreter, // fetch + nested table dispatch every instruction
+            Cached,      // pre-decoded instruction cache with fused pairs
+            Jit          // x86-64 recompiled blocks , falls back to Cached per block (and entirely if the host can't jit)
+        };
+
+        Chip8System(); // random CXNN seed
+        explicit Chip8System(uint32_t seed);
+        ~Chip8System();
+        // memory becomes the ROM's boot image (rom_cache.hpp) , shared with every other machine on that ROM until written
+        void load_ROM(const char* path); // through Rom_cache , the file is only read once
+        void load_ROM(const uint8_t* data, std::size_t size); // ROM image already in memory (e.g. embedded by chip8_aot)
+        void load_ROM(std::shared_ptr<const Rom_image> rom);
         void cycle();
+        uint64_t run(uint64_t budget); // execute up to budget cycles with the selected engine , returns cycles executed
+        void set_engine(Engine e);
+        Engine current_engine() const {return engine;}
+        void set_jit_lockstep(bool enabled) {jit_lockstep = enabled;} // re-run every jit block on the interpreter and compare
+        // quirk profile (see quirks.hpp) , Hybrid by default. switching rebuilds the dispatch tables with that
+        // profile's handlers and drops decoded/compiled code. the batch engine and chip8_aot always run Hybrid
+        void set_quirks(Quirk_profile profile);
+        Quirk_profile current_quirks() const {return quirks;}
+        Quirk_profile detect_rom_quirks() const; // last loaded ROM
+        // busy-wait elision (on by default): when run() comes back around a loop to the same pc with nothing changed
+        // (the usual FX07 / 3XNN / 1NNN wait on the delay timer) every later iteration is identical until the next
+        // tick_timers() , so it skips the whole iterations left in the budget. the resulting state is the same.
+        // budgets under IDLE_MIN_BUDGET never look
+        void set_idle_skip(bool enabled) {idle_skip = enabled;}
+        uint64_t idle_cycles_elided() const {return idle_elided;} // counted into run()'s return value , never executed
         void tick_timers();
         bool sound_active(); 
+
+        // cycle clock: an integer count of cpu cycles with the 60Hz timer ticks scheduled on it (frame f ends at
+        // cycle ((f + 1) * hz) / 60 , so nothing drifts). run_until() executes batches of run() between ticks and
+        // fires each tick itself. with Timing::Vip a cycle is a COSMAC VIP machine cycle and every instruction
+        // costs what the original interpreter took for it instead of one cycle
+        enum class Timing : uint8_t {Fixed, Vip};
+        static constexpr uint64_t TIMER_HZ = 60;
+        static constexpr uint64_t VIP_CYCLE_HZ = 220113; // 1.7609MHz 1802 , 8 clocks per machine cycle
+        void set_cpu_hz(uint64_t hz); // Timing::Fixed speed in instructions per second (default 700)
+        void set_timing(Timing t);
+        Timing current_timing() const {return timing;}
+        uint64_t clock_hz() const {return timing == Timing::Vip ? VIP_CYCLE_HZ : fixed_hz;}
+        uint64_t cycles() const {return clock_cycles;}
+        uint64_t timer_ticks() const {return clock_ticks;}
+        uint64_t next_tick_cycle() const {return clock_base_cycle + ((clock_ticks - clock_base_tick + 1) * clock_hz()) / TIMER_HZ;}
+        // runs until cycles() reaches target , ticking timers at every boundary on the way. returns instructions
+        // executed (idle-skipped ones included). run_until(next_tick_cycle()) runs exactly one frame
+        uint64_t run_until(uint64_t target);
+        void seek_ticks(uint64_t ticks); // move the clock to the start of frame `ticks` , after a rewind or load_state
+        static uint32_t vip_cycles(uint16_t opcode); // machine cycles the VIP interpreter spends on opcode
+        uint64_t display_hash() const; // FNV-1a over the framebuffer, for comparing runs headless
+#ifdef CHIP8_PROFILE
+        // every instruction cycle() executes , run() goes through cycle() for all engines in profiling builds
+        Profiler& profiler() {return prof;}
+        const Profiler& profiler() const {return prof;}
+#endif
+        // debugger stops (breakpoints.hpp) , created on first use. while any is armed run() and run_until() step the
+        // interpreter and return early , before the instruction that hit one. the engines and idle skip only come back
+        // once nothing is armed , so an unarmed run pays one pointer test per call and nothing per instruction
+        Breakpoints& breakpoints();
+        bool break_pending() const {return breaks && breaks->last_hit().kind != Breakpoints::Hit::Kind::None;} // the last run() stopped on one
+        // execution trace (trace.hpp) , off by default. while on , run() takes the same one instruction at a time loop
+        // as breakpoints and every executed instruction (cycle() too) lands in the ring. turning it off drops the ring
+        void set_tracing(bool on, std::size_t capacity = Trace_ring::DEFAULT_CAPACITY);
+        const Trace_ring* trace() const {return tracer.get();} // nullptr while off
         
-        Debug_snapshot snapshot(); 
-        void reset(); 
+        Debug_snapshot snapshot(std::size_t memory_base = START_ADDRESS) const; // through view() , reads only the window
+        void reset(); // power cycle , memory goes back to the loaded ROM's image
+        void seed(uint32_t value); // fixed CXNN sequence for reproducible headless runs
+        uint32_t current_seed() const {return rng_seed;}
+        const char* fault() const; // why the next cycle() would step outside memory/stack/keypad , nullptr if it's safe
+        bool halted() const; // pc sits on a jump to itself (how most ROMs end) , or on SUPER-CHIP's 00FD exit
+        bool waiting_for_key() const {return awaiting_input || awaiting_release;} // inside FX0A
+        // blocked in FX0A with both timers run down: no cycle , run or timer tick changes anything until a key edge
+        // lands in just_pressed/just_released , so a frontend can stop stepping and sleep until input arrives
+        bool suspended() const {return waiting_for_key() && delay_timer == 0 && sound_timer == 0;}
+
+        // binary save states (save_state.cpp). a full save becomes the base for later deltas , which only carry
+        // the memory pages written since then and the display words that differ from the base
+        static constexpr uint16_t STATE_VERSION = 3;
+        static constexpr std::size_t STATE_PAGES = 64; // memory is tracked in 64 pages , 64 bytes each (1KB with XO-CHIP memory)
+        std::size_t state_page_size() const {return memory_size / STATE_PAGES;}
+        std::vector<uint8_t> save_state();
+        std::vector<uint8_t> save_delta(const std::vector<uint8_t>& base) const;
+        void write_state(std::vector<uint8_t>& out) const; // full state without touching the delta base (rewind , movies)
+        void load_state(const std::vector<uint8_t>& state, const std::vector<uint8_t>* base = nullptr); // base required for deltas
 
 
     private:
-        uint16_t opcode; 
-        uint8_t memory[MEMORY_SIZE]{};
-        uint8_t registers[REGISTERS]{}; 
-        uint16_t stack[STACK_SIZE]{};    
-        uint8_t stack_pointer{}; 
-        uint16_t index_reg{}; // index register stores memory addresses for operations
+        friend class Aot_runtime; // recompiled ROMs drive the VM state directly
+        friend class Bench_probe; // chip8_bench times handlers and dispatch in isolation
+
+        // instruction with operands already pulled out of the opcode so handlers don't re-mask
+        struct Instruction;
+        using Chip8Func = void(Chip8System::*)(const Instruction&);
+        struct Instruction {
+            Chip8Func handler{nullptr}; // resolved leaf handler , nullptr = not decoded yet
+            uint16_t opcode{};
+            uint16_t nnn{};
+            uint8_t x{};
+            uint8_t y{};
+            uint8_t nn{};
+            uint8_t n{};
+            uint8_t length{1}; // instructions covered by this entry , 2 for a fused pair
+        };
+        static Instruction decode(uint16_t opcode);
+        struct Dispatch_tables; // one constant set per quirk profile and resolution , shared by every instance
+
+        // hot state , everything the dispatch loop and the common handlers touch on one 64-byte line
+        alignas(64) uint8_t registers[REGISTERS]{}; 
         uint16_t program_counter{}; // program counter register stores the next instruction to execute
+        uint16_t index_reg{}; // index register stores memory addresses for operations
+        uint16_t opcode{}; 
+        uint8_t stack_pointer{}; 
         uint8_t delay_timer{};
         uint8_t sound_timer{}; 
-        std::mt19937 rng; 
-        std::uniform_int_distribution<uint8_t> byte_dist{0,255};
         bool awaiting_input{false};
         bool awaiting_release{false};
+        bool vblank_wait{false}; // display_wait profiles: DXYN ran , nothing executes until tick_timers()
+        bool hires_mode{false};
+        uint8_t plane_mask{1}; // planes DXYN , 00E0 and the scrolls work on , XO-CHIP FN01 changes it
+        bool idle_skip{true};
+        bool idle_poll{false}; // FX07/EX9E/EXA1 ran since the last check , only loops reading timer or keys can be waits
+                               // (jit blocks that read the timer inline set it after they return)
+        std::unique_ptr<const uint8_t*[]> pages; // memory_size / MEMORY_PAGE_SIZE , the image's page or a private copy
+        const Dispatch_tables* tables{nullptr}; // set by init_tables()
+        std::unique_ptr<Instruction[]> decode_cache;
+        uint64_t display_generation{0};
+        // end of the hot line
+
+        // memory is paged over a shared Rom_image , a page gets its own copy on the first write to it
+        std::shared_ptr<const Rom_image> image;
+        std::vector<std::unique_ptr<uint8_t[]>> private_pages; // per page , nullptr while it's still the image's
+        std::size_t memory_size{MEMORY_SIZE}; // XO_MEMORY_SIZE while the profile has xochip_ops
+        // addresses wrap at memory_size (a power of two) , I can be walked past the end by FX1E or FX55's increment
+        uint8_t read(std::size_t address) const {return *memory_at(address);}
+        const uint8_t* memory_at(std::size_t address) const { // contiguous to the page end
+            address &= memory_size - 1;
+            return &pages[address / MEMORY_PAGE_SIZE][address % MEMORY_PAGE_SIZE];
+        }
+        uint16_t fetch(std::size_t address) const { // big-endian word , only an odd address at a page end straddles two pages
+            const uint8_t* at = memory_at(address);
+            if(address % MEMORY_PAGE_SIZE != MEMORY_PAGE_SIZE - 1) return static_cast<uint16_t>(at[0] << 8u | at[1]);
+            return static_cast<uint16_t>(at[0] << 8u | read(address + 1));
+        }
+        uint8_t* writable(std::size_t address); // privatizes the page first
+        void map_image(std::shared_ptr<const Rom_image> boot); // every page back to the image , private copies dropped
+        void restore_memory(const uint8_t* data); // all of memory_size , pages that match the image stay shared
+        void resize_memory(std::size_t size); // keeps the contents that fit
+        std::unique_ptr<Hires_screen> hires_buffer; // only while the profile has schip_ops
+        uint8_t flag_registers[FLAG_REGISTERS]{};
+        uint16_t stack[STACK_SIZE]{};    
+        Pcg32 rng; 
+        uint32_t rng_seed{}; // save states store seed + draws instead of the engine state
+        uint64_t rng_draws{0};
+        uint64_t dirty_pages{~0ull}; // one bit per state_page_size() memory page written since the last full save_state()
+        uint64_t dirty_row_mask{~0ull}; // starts all dirty so the first present uploads everything
+        void mark_display_changed(uint64_t rows) {dirty_row_mask |= rows; ++display_generation;}
+        void set_resolution(bool hires); // 00FE/00FF , clears the screen and swaps in that resolution's handlers
+        template<class S> S& screen();
+        uint64_t state_base{0}; // checksum of that full save , the only base save_delta accepts
+        void mark_dirty(uint16_t address, std::size_t length);
+        void copy_display_words(uint64_t* out) const; // the save state's display block
+        uint64_t memory_writes{0}; // FX33/FX55 count , lets the idle check see stores without comparing memory
         uint8_t wait_reg{0}; 
+        Quirk_profile quirks{Quirk_profile::Hybrid};
+        Timing timing{Timing::Fixed};
+        uint64_t state_changes{0};
+        std::unique_ptr<Breakpoints> breaks;
+        std::unique_ptr<Trace_ring> tracer;
+        uint64_t run_checked(uint64_t budget); // run() while breakpoints are armed
+        uint64_t run_traced(uint64_t budget); // run() while tracing , the cached engine with a record per instruction
+        void traced_execute(); // execute() , then record what it did
+        void record_trace(uint16_t pc, const uint64_t (&before)[2]); // before = registers ahead of the instruction
+        bool at_break(); // checks the instruction at pc , records the hit
+        Breakpoints::Access_range next_access(uint16_t op) const; // memory op is about to read or write
+        uint64_t fixed_hz{700};
+        uint64_t clock_cycles{0};
+        uint64_t clock_ticks{0};
+        uint64_t clock_base_cycle{0}; // where the clock stood when the speed last changed
+        uint64_t clock_base_tick{0};
+        void rebase_clock(); // call before the speed changes so past frames keep their boundaries
+        uint64_t run_vip(uint64_t stop); // Timing::Vip , one instruction at a time until cycles() >= stop
+#ifdef CHIP8_PROFILE
+        Profiler prof;
+#endif
         
-        using Chip8Func = void(Chip8System::*)();
+        // decode cache , one entry per address (some ROMs run entirely at odd addresses)
+        static constexpr std::size_t DECODE_CACHE_SIZE = MEMORY_SIZE;
+        Engine engine{Engine::Interpreter};
+
+        // everything an instruction can change outside memory and the display (those are covered by their counters)
+        struct Idle_probe {
+            uint16_t pc{}, i{};
+            uint8_t sp{}, dt{}, st{};
+            bool awaiting_input{}, awaiting_release{};
+            uint8_t down_key{}, wait_reg{};
+            uint64_t rng_draws{}, display_generation{}, memory_writes{};
+            uint8_t registers[REGISTERS]{};
+            uint16_t stack[STACK_SIZE]{};
+            bool operator==(const Idle_probe&) const = default;
+        };
+        bool idle_armed{false}; // idle_print holds a loop head seen during the current run()
+        bool idle_probed{false}; // idle_probe was taken at a lap whose fingerprint had already repeated
+        uint64_t idle_at{0}; // run() cycle count at the lap idle_print / idle_probe describe
+        uint64_t idle_print{0};
+        Idle_probe idle_probe{};
+        uint64_t idle_fingerprint() const;
+        // smaller run() budgets don't look for idle loops at all: a 700Hz frame is 11-12 cycles , a lap or two , and
+        // confirming a loop costs more than the cycles left to skip
+        static constexpr uint64_t IDLE_MIN_BUDGET = 64; // a few loads and multiplies over the probe's hot fields
+        uint64_t idle_elided{0};
+        uint64_t skip_idle(uint64_t done, uint64_t budget); // call after a backward jump , returns cycles skipped
+        Chip8Func resolve(uint16_t opcode) const;
+        Instruction& decode_at(uint16_t address);
+        void invalidate_code(uint16_t address, std::size_t length);
+        void clear_decode_cache();
+
+        std::unique_ptr<::Jit> jit;
+        bool jit_lockstep{false};
+        uint64_t run_jit_block(uint64_t budget); // 0 when no block could run at the current pc
         
         //dispatch tables
-        std::array<Chip8Func, INPUT_SIZE> table_master{}; 
-        std::array<Chip8Func, INPUT_SIZE> table_0{};
-        std::array<Chip8Func, INPUT_SIZE> table_8{};
-        std::array<Chip8Func, INPUT_SIZE> table_E{};
-        std::array<Chip8Func, F_TABLE_SIZE> table_F{}; 
-        
+        struct Dispatch_tables {
+            std::array<Chip8Func, INPUT_SIZE> table_master{}; 
+            std::array<Chip8Func, F_TABLE_SIZE> table_0{}; // by the low byte , SUPER-CHIP packed a dozen ops in here
+            std::array<Chip8Func, INPUT_SIZE> table_5{}; // XO-CHIP only , the others dispatch 5XY0 directly
+            std::array<Chip8Func, INPUT_SIZE> table_8{};
+            std::array<Chip8Func, INPUT_SIZE> table_E{};
+            std::array<Chip8Func, F_TABLE_SIZE> table_F{}; 
+            Chip8Func fused_draw{}; // fused_ANNN_DXYN for this profile and resolution
+            Chip8Func fused_wait{}; // fused_FX07_3XNN ..
+            Chip8Func fused_count{}; // .. and fused_7XNN_3XNN , XO-CHIP skips differ
+        };
         
         //dispatch functions
-        void init_tables();
-        void dispatch(); 
-        void Table_0_dispatch();
-        void Table_8_dispatch();
-        void Table_E_dispatch();
-        void Table_F_dispatch();
+        void init_tables(); // points tables at the set for the current quirk profile and resolution
+        template<class Q, class S> static constexpr Dispatch_tables make_tables();
+        template<class Q, class S> static const Dispatch_tables& tables_for(); // built at compile time , one copy per program
+        template<class Q> void skip(); // past the next instruction , XO-CHIP steps over all 4 bytes of F000 NNNN
+        void dispatch(const Instruction& ins); 
+        void execute(); // cycle() without the state_changes bump , run() counts once per call instead
+        void Table_0_dispatch(const Instruction& ins);
+        void Table_5_dispatch(const Instruction& ins);
+        void Table_8_dispatch(const Instruction& ins);
+        void Table_E_dispatch(const Instruction& ins);
+        void Table_F_dispatch(const Instruction& ins);
 
         //opcode functions
-        void op_NULL(); // dead op for invalid instructions
-        void op_0NNN(); // machine code routine command ( not needed for our purposes, but here for coverage)
-        void op_00E0(); // CLS: clear the display
-        void op_00EE(); // RET: returns from a subroutine
-        void op_1NNN(); // JP addr: jumps to location NNN
-        void op_2NNN(); // CALL addr: calls subroutine at NNN  
-        void op_3XNN(); // SE Vx, byte : skip next instruction if Vx == NN
-        void op_4XNN(); // SNE Vx, byte : skip next instruction if Vx != NN
-        void op_5XY0(); // SE Vx, Vy : skip next instruction if Vx == Vy 
-        void op_6XNN(); // LD Vx , byte : place value NN into register Vx
-        void op_7XNN(); // ADD Vx, byte  : adds value NN to value of register Vx , stores result in Vx
-        void op_8XY0(); // LD Vx, Vy : stores value of register Vy in register Vx
-        void op_8XY1(); // OR Vx, vy : bitwise OR on the values of Vx and Vy , store result in Vx 
-        void op_8XY2(); // AND Vx, Vy : bitwise AND on values of Vx and Vy, store result in Vx 
-        void op_8XY3(); // XOR Vx,Vy : bitwise exclusive OR on the values of Vx and Vy, store result in Vx 
-        void op_8XY4(); // ADD Vx,Vy : Vx = Vx + Vy, VF = cary
-        void op_8XY5(); // SUB Vx,Vy : Vx = Vx - Vy , set VF = NOT borrow. Vx > Vy , VF = 1 , else 0. 
-        void op_8XY6(); // SHR Vx {, Vy} :  least significant bit == 1 then VF = 1 , else 0 , Vx = Vx shift right 1 
-        void op_8XY7(); // SUBN Vx Vy : Vx = Vy - Vx , set VF = Not borrow 
-        void op_8XYE(); // SHL Vx  {, Vy} : Vx = Vx shift left 1
-        void op_9XY0(); // SNE Vx Vy : skip next instruction if Vx != Vy 
-        void op_ANNN(); // LD I , addr Set I = nnn 
-        void op_BNNN(); // P V0 , addr : PC = nnn + V0
-        void op_CXNN(); // RND Vx, byte Vx = random byte AND NN 
-        void op_DXYN(); // DRW Vx , Vy , nibble : draws sprites for the display 
-        void op_EX9E(); // SKP Vx : skip next instruction if the key with value Vx is pressed
-        void op_EXA1(); // SKNP Vx : sip next instructio nif the key with value Vx is not pressed
-        void op_FX07(); // LD Vx , Dt : Set Vx = delay timer value 
-        void op_FX0A(); // LD Vx, k : wait for a key press and store the key value in Vx . Pauses execution
-        void op_FX15(); // LD DT,  Vx : delay timer = Vx 
-        void op_FX18(); // LD ST, Vx : sound timer = Vx 
-        void op_FX1E(); // Add I , Vx :  I = I + Vx I = I + Vx 
-        void op_FX29(); // LD F , Vx : I = sprite location digit Vx 
-        void op_FX33(); // LD B, Vx : store BCD rep of Vx in memory locations I, I+1, I+2 
-        void op_FX55(); // LD [I] , Vx : Store rgisters V0 through Vx in meory starting at location I 
-        void op_FX65(); // LD vx, [i] : Read registers V0 thoruhg Vx from memory starting at location I 
+        void op_NULL(const Instruction& ins); // dead op for invalid instructions
+        void op_0NNN(const Instruction& ins); // machine code routine command ( not needed for our purposes, but here for coverage)
+        template<class S> void op_00E0(const Instruction& ins); // CLS: clear the display (the selected planes)
+        void op_00EE(const Instruction& ins); // RET: returns from a subroutine
+        void op_1NNN(const Instruction& ins); // JP addr: jumps to location NNN
+        void op_2NNN(const Instruction& ins); // CALL addr: calls subroutine at NNN  
+        template<class Q> void op_3XNN(const Instruction& ins); // SE Vx, byte : skip next instruction if Vx == NN
+        template<class Q> void op_4XNN(const Instruction& ins); // SNE Vx, byte : skip next instruction if Vx != NN
+        template<class Q> void op_5XY0(const Instruction& ins); // SE Vx, Vy : skip next instruction if Vx == Vy 
+        void op_6XNN(const Instruction& ins); // LD Vx , byte : place value NN into register Vx
+        void op_7XNN(const Instruction& ins); // ADD Vx, byte  : adds value NN to value of register Vx , stores result in Vx
+        void op_8XY0(const Instruction& ins); // LD Vx, Vy : stores value of register Vy in register Vx
+        template<class Q> void op_8XY1(const Instruction& ins); // OR Vx, vy : bitwise OR on the values of Vx and Vy , store result in Vx 
+        template<class Q> void op_8XY2(const Instruction& ins); // AND Vx, Vy : bitwise AND on values of Vx and Vy, store result in Vx 
+        template<class Q> void op_8XY3(const Instruction& ins); // XOR Vx,Vy : bitwise exclusive OR on the values of Vx and Vy, store result in Vx 
+        void op_8XY4(const Instruction& ins); // ADD Vx,Vy : Vx = Vx + Vy, VF = cary
+        void op_8XY5(const Instruction& ins); // SUB Vx,Vy : Vx = Vx - Vy , set VF = NOT borrow. Vx > Vy , VF = 1 , else 0. 
+        template<class Q> void op_8XY6(const Instruction& ins); // SHR Vx {, Vy} :  least significant bit == 1 then VF = 1 , else 0 , Vx = Vx shift right 1 
+        void op_8XY7(const Instruction& ins); // SUBN Vx Vy : Vx = Vy - Vx , set VF = Not borrow 
+        template<class Q> void op_8XYE(const Instruction& ins); // SHL Vx  {, Vy} : Vx = Vx shift left 1
+        template<class Q> void op_9XY0(const Instruction& ins); // SNE Vx Vy : skip next instruction if Vx != Vy 
+        void op_ANNN(const Instruction& ins); // LD I , addr Set I = nnn 
+        template<class Q> void op_BNNN(const Instruction& ins); // P V0 , addr : PC = nnn + V0
+        void op_CXNN(const Instruction& ins); // RND Vx, byte Vx = random byte AND NN 
+        template<class Q, class S> void op_DXYN(const Instruction& ins); // DRW Vx , Vy , nibble : draws sprites for the display 
+        template<class Q> void op_EX9E(const Instruction& ins); // SKP Vx : skip next instruction if the key with value Vx is pressed
+        template<class Q> void op_EXA1(const Instruction& ins); // SKNP Vx : sip next instructio nif the key with value Vx is not pressed
+        void op_FX07(const Instruction& ins); // LD Vx , Dt : Set Vx = delay timer value 
+        void op_FX0A(const Instruction& ins); // LD Vx, k : wait for a key press and store the key value in Vx . Pauses execution
+        void op_FX15(const Instruction& ins); // LD DT,  Vx : delay timer = Vx 
+        void op_FX18(const Instruction& ins); // LD ST, Vx : sound timer = Vx 
+        void op_FX1E(const Instruction& ins); // Add I , Vx :  I = I + Vx I = I + Vx 
+        void op_FX29(const Instruction& ins); // LD F , Vx : I = sprite location digit Vx 
+        void op_FX33(const Instruction& ins); // LD B, Vx : store BCD rep of Vx in memory locations I, I+1, I+2 
+        template<class Q> void op_FX55(const Instruction& ins); // LD [I] , Vx : Store rgisters V0 through Vx in meory starting at location I 
+        template<class Q> void op_FX65(const Instruction& ins); // LD vx, [i] : Read registers V0 thoruhg Vx from memory starting at location I 
+
+        // SUPER-CHIP
+        template<class S> void op_00CN(const Instruction& ins); // SCD n : scroll the display down n lines
+        template<class S> void op_00FB(const Instruction& ins); // SCR : scroll right 4 pixels
+        template<class S> void op_00FC(const Instruction& ins); // SCL : scroll left 4 pixels
+        void op_00FD(const Instruction& ins); // EXIT : stop the interpreter , we park the pc on it
+        void op_00FE(const Instruction& ins); // LOW : 64x32
+        void op_00FF(const Instruction& ins); // HIGH : 128x64
+        void op_FX30(const Instruction& ins); // LD HF , Vx : I = big font digit Vx
+        void op_FX75(const Instruction& ins); // LD R , Vx : store V0 through Vx in the flag registers
+        void op_FX85(const Instruction& ins); // LD Vx , R : read V0 through Vx back from the flag registers
+        // XO-CHIP
+        template<class S> void op_00DN(const Instruction& ins); // scroll up n lines
+        void op_5XY2(const Instruction& ins); // save Vx through Vy (either order) at I , I unchanged
+        void op_5XY3(const Instruction& ins); // load Vx through Vy from I
+        void op_F000(const Instruction& ins); // I = the 16-bit word after the instruction
+        void op_FN01(const Instruction& ins); // select the planes drawing and scrolling use (n = plane mask)
+
+        //fused pairs (superinstructions) , only built by the decode cache. second instruction is the entry 2 bytes on
+        template<class Q, class S> void fused_ANNN_DXYN(const Instruction& ins); // set I then draw , how nearly every sprite gets drawn
+        void fused_6XNN_6XNN(const Instruction& ins); // back to back register loads (coordinates , counters)
+        template<class Q> void fused_FX07_3XNN(const Instruction& ins); // read delay timer then test it , the usual wait loop
+        template<class Q> void fused_7XNN_3XNN(const Instruction& ins); // bump a counter then test it , loop tails
 };
@@ -6,6 +6,7 @@ void Debug::flip_mode(){
 
     cycle_budget = 0;
     pause_upon_present = false; 
+    rewind_budget = 0;
 }
 
 void Debug::step_one_cycle() {
@@ -19,6 +20,28 @@ void Debug::step_one_render(){
     cycle_budget = 0; 
     pause_upon_present = true; 
 }
+void Debug::on_break(){
+    mode = Mode::Paused;
+    cycle_budget = 0;
+    pause_upon_present = false;
+    rewind_budget = 0;
+}
+
+void Debug::step_back_frame(){
+    if(mode == Mode::Paused) rewind_budget = 1;
+}
+
+bool Debug::can_rewind_frame(bool rewind_held){
+    // running: rewind for as long as the key is held , paused: one frame per press
+    if(mode == Mode::Running) return rewind_held;
+
+    if(rewind_budget > 0) {
+        --rewind_budget;
+        return true;
+    }
+    return false;
+}
+
 bool Debug::can_execute_cycle(){
     if(mode == Mode::Running) return true; 
     
@@ -11,6 +11,9 @@ class Debug {
         void flip_mode(); 
         void step_one_cycle(); 
         void step_one_render();
+        void step_back_frame(); // paused only , held rewind while running is handled by can_rewind_frame
+        void on_break(); // a breakpoint stopped the VM mid-frame , pause there
+        bool can_rewind_frame(bool rewind_held);
         bool can_execute_cycle();
         bool can_tick_timers(); 
         void on_frame_presented(); 
@@ -19,4 +22,5 @@ class Debug {
         Mode mode{Mode::Running};
         uint32_t cycle_budget{0};
         bool pause_upon_present{false};
+        uint32_t rewind_budget{0};
 };
\ No newline at end of file
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <iterator>
+
+#include "emulation_thread.hpp"
+
+Emulation_thread::Emulation_thread(Chip8System& chip8, Movie* movie, bool playing)
+    : chip8(chip8), movie(movie), playing(playing) {}
+
+Emulation_thread::~Emulation_thread() {
+    stop();
+}
+
+void Emulation_thread::start() {
+    quit.store(false, std::memory_order_relaxed);
+    failed.store(false, std::memory_order_relaxed);
+    publish(); // so the first present has a frame before the thread gets going
+    worker = std::thread([this] {loop();});
+}
+
+void Emulation_thread::stop() {
+    quit.store(true, std::memory_order_relaxed);
+    wake();
+    if(worker.joinable()) worker.join();
+}
+
+bool Emulation_thread::send(const Input_event& e) {
+    if(!events.push(e)) return false;
+    ++sent;
+    wake();
+    return true;
+}
+
+void Emulation_thread::wake() {
+    {
+        std::lock_guard<std::mutex> lock(wake_lock);
+        wake_pending = true;
+    }
+    wake_cv.notify_one();
+}
+
+bool Emulation_thread::idle() {
+    if(rewind_held) return false;
+    if(debugger.current_mode() == Debug::Mode::Paused) return true; // steps and rewinds all come in as events
+    return chip8.suspended() && !(movie && playing); // a movie presses keys on its own schedule
+}
+
+void Emulation_thread::loop() {
+    using clock = std::chrono::steady_clock;
+    using std::chrono::nanoseconds;
+    constexpr uint64_t NS_PER_S = 1'000'000'000;
+    const nanoseconds period((NS_PER_S + TIMER_HZ - 1) / TIMER_HZ);
+    // wall time is counted in whole frames since epoch , so pacing doesn't drift either
+    auto epoch = clock::now();
+    uint64_t paced = 0; // frames run since epoch
+    try {
+        while(!quit.load(std::memory_order_relaxed)) {
+            Input_event e;
+            while(events.pop(e)) {
+                apply(e);
+                ++applied;
+            }
+
+            if(turbo && debugger.current_mode() == Debug::Mode::Running && !rewind_held && !idle()) {
+                step();
+                epoch = clock::now(); // uncapped , pacing picks up from here once turbo is released
+                paced = 0;
+                continue;
+            }
+            const uint64_t elapsed = static_cast<uint64_t>(std::chrono::duration_cast<nanoseconds>(clock::now() - epoch).count());
+            const uint64_t due = elapsed * TIMER_HZ / NS_PER_S;
+            if(due > paced + MAX_CATCH_UP) paced = due - MAX_CATCH_UP; // host stall , drop the backlog instead of sprinting
+            for(; paced < due; ++paced) step();
+
+            if(idle()) {
+                publish(); // the render thread may still be waiting on a snapshot
+                std::unique_lock<std::mutex> lock(wake_lock);
+                wake_cv.wait(lock, [this] {return wake_pending || quit.load(std::memory_order_relaxed);});
+                wake_pending = false;
+                // the frames slept through never happen , and one is due right away to act on whatever woke us
+                epoch = clock::now() - period;
+                paced = 0;
+                continue;
+            }
+            const uint64_t next = ((paced + 1) * NS_PER_S + TIMER_HZ - 1) / TIMER_HZ;
+            std::this_thread::sleep_until(epoch + nanoseconds(next));
+        }
+    } catch(const std::exception& ex) {
+        std::cerr << "Emulation stopped: " << ex.what() << std::endl;
+        dump_trace("emulation stopped");
+        failed.store(true, std::memory_order_relaxed);
+    }
+}
+
+void Emulation_thread::apply(const Input_event& e) {
+    const uint8_t k = e.key & (Chip8System::INPUT_SIZE - 1);
+    switch(e.kind) {
+        case Input_event::Kind::Key_down:
+            chip8.keys[k] = 1;
+            chip8.just_pressed[k] = 1;
+            break;
+        case Input_event::Kind::Key_up:
+            chip8.keys[k] = 0;
+            chip8.just_released[k] = 1;
+            break;
+        case Input_event::Kind::Flip_mode: debugger.flip_mode(); break;
+        case Input_event::Kind::Step_cycle: debugger.step_one_cycle(); break;
+        case Input_event::Kind::Step_frame: debugger.step_one_render(); break;
+        case Input_event::Kind::Rewind_down:
+            rewind_held = true;
+            debugger.step_back_frame();
+            break;
+        case Input_event::Kind::Rewind_up: rewind_held = false; break;
+        case Input_event::Kind::Turbo_down: turbo = true; break;
+        case Input_event::Kind::Turbo_up: turbo = false; break;
+        case Input_event::Kind::Toggle_breakpoint: {
+            const uint16_t pc = chip8.view().pc;
+            const bool on = chip8.breakpoints().toggle_pc(pc);
+            std::cerr << "breakpoint " << (on ? "set" : "cleared") << " at 0x" << std::hex << pc << std::dec << std::endl;
+            break;
+        }
+        case Input_event::Kind::Dump_trace: dump_trace("requested"); break;
+    }
+}
+
+void Emulation_thread::step() {
+    tick();
+    publish();
+    debugger.on_frame_presented();
+}
+
+void Emulation_thread::tick() {
+    // frames are recorded at the timer tick , so rewinding walks back one 60Hz frame per tick
+    if(debugger.can_rewind_frame(rewind_held)) {
+        const uint64_t back = frame_open ? 2 : 1; // a frame stopped part way was counted but never recorded
+        if(frame_count >= back && rewind.step_back(chip8)) {
+            frame_count -= back;
+            frame_open = false;
+            if(movie && !playing) movie->truncate(frame_count); // re-record from here
+            chip8.seek_ticks(frame_count); // so the re-run frames get the same cycle split as the first time
+        }
+    } else if(debugger.can_tick_timers()) {
+        run_frame();
+        return;
+    } else if(debugger.current_mode() == Debug::Mode::Paused && debugger.can_execute_cycle()) {
+        run_cycle();
+        return;
+    }
+    // edges that arrived while nothing ran are dropped , like a poll that no cycle saw
+    std::fill(std::begin(chip8.just_pressed), std::end(chip8.just_pressed), 0);
+    std::fill(std::begin(chip8.just_released), std::end(chip8.just_released), 0);
+}
+
+void Emulation_thread::begin_frame() {
+    if(frame_open) return; // already counted and fed its input
+    // a movie replaces the live keypad , or records what the frame is about to see
+    if(movie) {
+        if(playing) playing = movie->apply(chip8, frame_count);
+        else movie->record(chip8);
+    }
+    ++frame_count;
+}
+
+void Emulation_thread::end_frame() {
+    rewind.record(chip8);
+    std::fill(std::begin(chip8.just_pressed), std::end(chip8.just_pressed), 0);
+    std::fill(std::begin(chip8.just_released), std::end(chip8.just_released), 0);
+}
+
+void Emulation_thread::run_cycle() {
+    // one instruction of the current frame on the vm clock , the step that reaches the timer tick ends the frame
+    begin_frame();
+    const uint64_t ticks = chip8.timer_ticks();
+    chip8.run_until(chip8.cycles() + 1);
+    frame_open = chip8.timer_ticks() == ticks;
+    if(!frame_open) end_frame();
+}
+
+void Emulation_thread::run_frame() {
+    begin_frame();
+    chip8.run_until(chip8.next_tick_cycle()); // ends on the timer tick
+    frame_open = chip8.break_pending();
+    if(frame_open) {
+        // key edges stay for the rest of the frame
+        const Breakpoints::Hit& hit = chip8.breakpoints().last_hit();
+        std::cerr << "break: " << chip8.breakpoints().describe(hit) << std::endl;
+        if(hit.kind == Breakpoints::Hit::Kind::Read || hit.kind == Breakpoints::Hit::Kind::Write) dump_trace("watchpoint");
+        debugger.on_break();
+        return;
+    }
+    end_frame();
+}
+
+void Emulation_thread::publish() {
+    Frame& f = frames.back();
+    f.hires = chip8.hires();
+    if(f.hires) f.hires_display = chip8.hires_display();
+    else f.lores_display = chip8.lores_display;
+    f.generation = chip8.frame_generation();
+    f.sound = chip8.sound_active();
+    f.mode = debugger.current_mode();
+    f.suspended = idle();
+    f.events_seen = applied;
+    const bool had_snapshot = f.has_snapshot;
+    f.has_snapshot = want_snapshot.load(std::memory_order_relaxed);
+    if(f.has_snapshot) {
+        // this slot went out a couple of publishes ago , paused or in a key wait it usually still holds this state
+        const uint16_t base = memory_window.load(std::memory_order_relaxed);
+        if(!had_snapshot || f.snapshot.generation != chip8.state_generation() || f.memory_window != base) {
+            f.snapshot = chip8.snapshot(base);
+            f.memory_window = base;
+        }
+    }
+#ifdef CHIP8_PROFILE
+    f.has_heat = want_heat.load(std::memory_order_relaxed);
+    if(f.has_heat) {
+        f.heat_base = static_cast<uint16_t>(chip8.view().pc & ~(Frame::HEAT_WINDOW - 1));
+        std::copy_n(chip8.profiler().pc_counts() + f.heat_base, f.pc_heat.size(), f.pc_heat.begin());
+    }
+#endif
+    frames.publish();
+}
+
+void Emulation_thread::dump_trace(const char* why) {
+    const Trace_ring* trace = chip8.trace();
+    if(!trace || trace_path.empty()) return;
+    try {
+        trace->save(trace_path.c_str());
+        std::cerr << "trace (" << why << "): last " << std::min<uint64_t>(trace->recorded(), trace->capacity())
+                  << " instructions written to " << trace_path << std::endl;
+    } catch(const std::exception& ex) {
+        std::cerr << "Failed to write trace: " << ex.what() << std::endl;
+    }
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "chip8_emulator.hpp"
+#include "debugger.hpp"
+#include "movie.hpp"
+#include "rewind.hpp"
+#include "spsc_queue.hpp"
+#include "triple_buffer.hpp"
+
+// everything the SDL thread tells the emulation thread , in the order it happened
+struct Input_event {
+    enum class Kind : uint8_t {
+        Key_down,
+        Key_up,
+        Flip_mode,
+        Step_cycle,
+        Step_frame,
+        Rewind_down,
+        Rewind_up,
+        Turbo_down,
+        Turbo_up,
+        Toggle_breakpoint, // at the current pc
+        Dump_trace, // write the trace ring to the dump_trace_to() file
+    };
+    Kind kind{Kind::Key_down};
+    uint8_t key{0}; // keypad index for Key_down/Key_up
+};
+using Input_queue = Spsc_queue<Input_event, 256>;
+
+// runs the VM on its own thread in whole 60Hz frames (Chip8System::run_until the next timer tick) so presenting
+// never stalls emulation. speed and timing are whatever the VM was configured with before start().
+// after a host stall it runs at most MAX_CATCH_UP frames back to back and drops the rest. owns the debugger , rewind history and movie playback/recording.
+// frames go out through a triple buffer , input comes in through an SPSC queue.
+// with turbo held the thread runs frames back to back instead of sleeping to the next tick.
+// a breakpoint hit (Chip8System::breakpoints()) pauses the debugger mid-frame , resuming finishes that frame. paused single
+// steps run on the vm clock inside the current frame too , so movies and rewind see them like any other cycles.
+// while nothing can change without input (paused , or the VM suspended in FX0A) it stops ticking and sleeps until
+// the render thread sends an event or asks for a different frame.
+class Emulation_thread {
+    public:
+        static constexpr uint64_t TIMER_HZ = Chip8System::TIMER_HZ;
+        static constexpr uint64_t MAX_CATCH_UP = 4;
+
+        struct Frame {
+            bool hires{false}; // which of the two screens below is current , only that one is copied
+            Chip8System::Lores_screen lores_display{};
+            Chip8System::Hires_screen hires_display{};
+            uint64_t generation{0}; // Chip8System::frame_generation() , unchanged means the same picture
+            bool sound{false};
+            Debug::Mode mode{Debug::Mode::Running};
+            bool suspended{false}; // the thread is asleep until the next event , nothing changes before that
+            uint64_t events_seen{0}; // events applied before this frame , compare with events_sent()
+            bool has_snapshot{false}; // only filled while request_snapshot(true)
+            Chip8System::Debug_snapshot snapshot{}; // re-read only when the VM moved or the window did
+            uint16_t memory_window{0}; // the request_memory_window() the snapshot was taken for
+#ifdef CHIP8_PROFILE
+            static constexpr std::size_t HEAT_WINDOW = 4096; // what the overlay heatmap shows
+            bool has_heat{false}; // only filled while request_heatmap(true)
+            uint16_t heat_base{0}; // the 4KB of code the pc is in , pc_heat[a] counts address heat_base + a
+            std::array<uint64_t, HEAT_WINDOW> pc_heat{};
+#endif
+        };
+
+        // movie may be nullptr , playing picks playback over recording into it
+        Emulation_thread(Chip8System& chip8, Movie* movie, bool playing);
+        ~Emulation_thread();
+
+        void start();
+        void stop(); // joins , the VM and movie are safe to touch again afterwards
+        // with tracing on (Chip8System::set_tracing) the ring is written here on Dump_trace , on a watchpoint hit and
+        // when the VM throws. call before start()
+        void dump_trace_to(std::string path) {trace_path = std::move(path);}
+
+        bool crashed() const {return failed.load(std::memory_order_relaxed);} // the VM threw , message already on stderr
+        // render thread side
+        bool send(const Input_event& e); // false when the queue is full and the event was dropped
+        uint64_t events_sent() const {return sent;}
+        void request_snapshot(bool on) {if(want_snapshot.exchange(on, std::memory_order_relaxed) != on) wake();}
+        void request_heatmap(bool on) {if(want_heat.exchange(on, std::memory_order_relaxed) != on) wake();}
+        // where the snapshot's memory window starts , clamped to the VM's memory by the snapshot
+        void request_memory_window(uint16_t base) {if(memory_window.exchange(base, std::memory_order_relaxed) != base) wake();}
+        const Frame& newest_frame() {frames.update(); return frames.front();} // render thread only
+
+    private:
+        Chip8System& chip8;
+        Movie* movie;
+        bool playing;
+        Debug debugger;
+        Rewind_buffer rewind;
+        uint64_t frame_count{0}; // emulated frames , the movie position (the VM clock follows it on rewind)
+        bool rewind_held{false};
+        bool turbo{false};
+        bool frame_open{false}; // a breakpoint or single steps stopped the current frame , it's already counted and fed its input
+        std::string trace_path;
+
+        Input_queue events;
+        uint64_t sent{0}; // render thread only
+        uint64_t applied{0}; // emulation thread only
+        std::mutex wake_lock;
+        std::condition_variable wake_cv;
+        bool wake_pending{false}; // guarded by wake_lock
+        Triple_buffer<Frame> frames;
+        std::atomic<bool> want_snapshot{false};
+        std::atomic<bool> want_heat{false};
+        std::atomic<uint16_t> memory_window{Chip8System::START_ADDRESS};
+        std::atomic<bool> quit{false};
+        std::atomic<bool> failed{false};
+        std::thread worker;
+
+        void loop();
+        void wake();
+        bool idle(); // ticking would change nothing until the next event
+        void apply(const Input_event& e);
+        void step(); // tick , then publish the result
+        void tick(); // one 60Hz step: a frame , a rewind step or (paused) the single cycle the debugger allows
+        void run_frame();
+        void run_cycle(); // a paused single step , inside the current frame
+        void begin_frame(); // counts the frame and feeds it the movie's input , once
+        void end_frame(); // at the timer tick: rewind history , then the frame's key edges are dropped
+        void publish();
+        void dump_trace(const char* why);
+};
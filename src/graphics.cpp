@@ -1,10 +1,15 @@
 #include <iostream> 
+#include <algorithm>
 #include <cstring>
-#include <sstream>
-#include <iomanip> 
+#include <cstdio>
+#include <cmath>
 
 #include "graphics.hpp"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 
 static int getKeyMapping(SDL_Keycode key) {
     switch (key) {
@@ -28,6 +33,41 @@ static int getKeyMapping(SDL_Keycode key) {
     }
 }
 
+// ARGB per colour index (plane 0 bit | plane 1 bit << 1) , plain CHIP-8 only ever uses the first two
+static constexpr uint32_t PALETTE[4] = {0x00000000u, 0xFFFFFFFFu, 0xFFAAAAAAu, 0xFF555555u};
+
+// bitplane rows (bit 63 of word 0 = leftmost pixel) to ARGB , on pixels are 0xFFFFFFFF like the old framebuffer
+template<class S> static void expand_rows(const S& screen, int first, int count, uint32_t* out) {
+    constexpr int W = static_cast<int>(S::WIDTH);
+    for (int y = first; y < first + count; ++y) {
+        for (int w = 0; w < static_cast<int>(S::WORDS); ++w) {
+            const uint64_t row = screen.rows[0][y][w];
+            uint32_t* dst_row = out + (y - first) * W + w * 64;
+            const uint64_t plane1 = screen.rows[1][y][w];
+            if (plane1) {
+                // XO-CHIP second plane , per pixel through the palette
+                for (int x = 0; x < 64; ++x) {
+                    dst_row[x] = PALETTE[((row >> (63 - x)) & 1u) | ((plane1 >> (63 - x)) & 1u) << 1];
+                }
+                continue;
+            }
+#if defined(__SSE2__)
+            // broadcast each sprite byte and test 4 bits per vector , 8 pixels per byte in two stores
+            const __m128i hi = _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+            const __m128i lo = _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+            for (int b = 0; b < 8; ++b) {
+                const __m128i v = _mm_set1_epi32(static_cast<int>((row >> (56 - 8 * b)) & 0xFFu));
+                auto* dst = reinterpret_cast<__m128i*>(dst_row + b * 8);
+                _mm_storeu_si128(dst, _mm_cmpeq_epi32(_mm_and_si128(v, hi), hi));
+                _mm_storeu_si128(dst + 1, _mm_cmpeq_epi32(_mm_and_si128(v, lo), lo));
+            }
+#else
+            for (int x = 0; x < 64; ++x) dst_row[x] = PALETTE[(row >> (63 - x)) & 1u];
+#endif
+        }
+    }
+}
+
 void Graphics::audio_callback(void* userdata, Uint8* stream, int len) {
     auto* self = static_cast<Graphics*>(userdata);
     auto* out = reinterpret_cast<float*>(stream);
@@ -85,7 +125,14 @@ bool Graphics::init(const char* title, int scale) {
         WIDTH,
         HEIGHT
     );
-    if(!texture) {
+    hires_texture = SDL_CreateTexture(
+        renderer,
+        SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STREAMING,
+        HIRES_WIDTH,
+        HIRES_HEIGHT
+    );
+    if(!texture || !hires_texture) {
         std::cerr << "texture creation failed" << SDL_GetError() <<std::endl;
         return false; 
     }
@@ -113,102 +160,235 @@ bool Graphics::init(const char* title, int scale) {
     if (!debug_font) {
         std::cerr << "Font load failed: " << TTF_GetError() << std::endl;
     }
+    build_glyph_atlas();
     return true; 
 }
 
-void Graphics::draw_debug_text(int x, int y, const std::string& text) {
+void Graphics::build_glyph_atlas() {
     if (!debug_font) return;
-    SDL_Color fg{240, 240, 240, 255};
-    SDL_Surface* s = TTF_RenderUTF8_Blended(debug_font, text.c_str(), fg);
-    if (!s) return;
-    SDL_Texture* t = SDL_CreateTextureFromSurface(renderer, s);
-    SDL_Rect r{x, y, s->w, s->h};
-    SDL_FreeSurface(s);
-    if (!t) return;
-    SDL_RenderCopy(renderer, t, nullptr, &r);
-    SDL_DestroyTexture(t);
+    const SDL_Color white{255, 255, 255, 255}; // tinted at draw time with SDL_SetTextureColorMod
+    std::array<SDL_Surface*, LAST_GLYPH - FIRST_GLYPH + 1> rendered{};
+    int width = 0;
+    int height = 0;
+    for (std::size_t g = 0; g < rendered.size(); ++g) {
+        const Uint16 ch = static_cast<Uint16>(FIRST_GLYPH + g);
+        rendered[g] = TTF_RenderGlyph_Blended(debug_font, ch, white);
+        int minx = 0, maxx = 0, miny = 0, maxy = 0, advance = 0;
+        TTF_GlyphMetrics(debug_font, ch, &minx, &maxx, &miny, &maxy, &advance);
+        glyphs[g].advance = advance;
+        if (!rendered[g]) continue;
+        glyphs[g].src = SDL_Rect{width, 0, rendered[g]->w, rendered[g]->h};
+        width += rendered[g]->w + 1; // 1px gap so linear filtering can't bleed neighbours in
+        height = std::max(height, rendered[g]->h);
+    }
+
+    SDL_Surface* atlas = width > 0 ? SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888) : nullptr;
+    for (std::size_t g = 0; g < rendered.size(); ++g) {
+        if (!rendered[g]) continue;
+        if (atlas) {
+            SDL_SetSurfaceBlendMode(rendered[g], SDL_BLENDMODE_NONE); // copy alpha as is
+            SDL_Rect dst = glyphs[g].src;
+            SDL_BlitSurface(rendered[g], nullptr, atlas, &dst);
+        }
+        SDL_FreeSurface(rendered[g]);
+    }
+    if (!atlas) {
+        std::cerr << "Glyph atlas failed: " << SDL_GetError() << std::endl;
+        return;
+    }
+    glyph_atlas = SDL_CreateTextureFromSurface(renderer, atlas);
+    SDL_FreeSurface(atlas);
+    if (!glyph_atlas) {
+        std::cerr << "Glyph atlas texture failed: " << SDL_GetError() << std::endl;
+        return;
+    }
+    SDL_SetTextureBlendMode(glyph_atlas, SDL_BLENDMODE_BLEND);
+    SDL_SetTextureColorMod(glyph_atlas, 240, 240, 240);
+}
+
+void Graphics::draw_debug_text(int x, int y, const std::string& text) {
+    if (!glyph_atlas) return;
+    for (const char c : text) {
+        if (c < FIRST_GLYPH || c > LAST_GLYPH) continue;
+        const Glyph& g = glyphs[c - FIRST_GLYPH];
+        if (g.src.w > 0) text_batch.push_back({g.src, SDL_Rect{x, y, g.src.w, g.src.h}});
+        x += g.advance;
+    }
 }
- 
 
+void Graphics::flush_text() {
+    // every quad samples the same texture , so the renderer batches these into one draw
+    for (const Glyph_quad& q : text_batch) SDL_RenderCopy(renderer, glyph_atlas, &q.src, &q.dst);
+    text_batch.clear();
+}
 
-void Graphics::render(const uint32_t* framebuffer,
+void Graphics::update_overlay_lines(const Chip8System::Debug_snapshot& snapshot, Debug::Mode mode) {
+    char buf[64];
+    if (!overlay_valid || snapshot.pc != shown.pc || snapshot.opcode != shown.opcode || snapshot.i != shown.i) {
+        std::snprintf(buf, sizeof(buf), "PC: 0x%04x  OP: 0x%04x  I: 0x%04x", snapshot.pc, snapshot.opcode, snapshot.i);
+        overlay_lines[0] = buf;
+    }
+    if (!overlay_valid || snapshot.dt != shown.dt || snapshot.st != shown.st || snapshot.sp != shown.sp || mode != shown.mode) {
+        std::snprintf(buf, sizeof(buf), "DT: %d  ST: %d  SP: %d  MODE: %s", snapshot.dt, snapshot.st, snapshot.sp,
+            mode == Debug::Mode::Running ? "RUN" : "PAUSE");
+        overlay_lines[1] = buf;
+    }
+    for (std::size_t r = 0; r < Chip8System::REGISTERS; ++r) {
+        if (overlay_valid && snapshot.registers[r] == shown.registers[r]) continue;
+        std::snprintf(buf, sizeof(buf), "V%X: %02X", static_cast<unsigned>(r), snapshot.registers[r]);
+        overlay_lines[2 + r] = buf;
+    }
+    for (int row = 0; row < MEMORY_LINES; ++row) {
+        const auto* bytes = snapshot.memory.data() + row * MEMORY_ROW;
+        if (overlay_valid && snapshot.memory_base == shown.memory_base && std::equal(bytes, bytes + MEMORY_ROW, shown.memory.data() + row * MEMORY_ROW)) continue;
+        int n = std::snprintf(buf, sizeof(buf), "%04X:", static_cast<unsigned>(snapshot.memory_base + row * MEMORY_ROW));
+        for (int b = 0; b < MEMORY_ROW; ++b) n += std::snprintf(buf + n, sizeof(buf) - n, " %02X", bytes[b]);
+        overlay_lines[2 + 16 + row] = buf;
+    }
+    shown = {snapshot.pc, snapshot.opcode, snapshot.i, snapshot.dt, snapshot.st, snapshot.sp, mode, snapshot.registers,
+        snapshot.memory_base, snapshot.memory, snapshot.generation};
+    overlay_valid = true;
+}
+
+// log scaled black -> red -> yellow -> white per address , the current pc is outlined
+void Graphics::draw_heatmap(const uint64_t* pc_heat, uint16_t base, uint16_t pc) {
+    if (!heatmap) {
+        heatmap = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, HEATMAP_SIDE, HEATMAP_SIDE);
+        if (!heatmap) return;
+    }
+    uint64_t peak = 0;
+    for (int a = 0; a < HEATMAP_SIDE * HEATMAP_SIDE; ++a) peak = std::max(peak, pc_heat[a]);
+    const float norm = peak ? 1.0f / std::log1p(static_cast<float>(peak)) : 0.0f;
+    for (int a = 0; a < HEATMAP_SIDE * HEATMAP_SIDE; ++a) {
+        if (!pc_heat[a]) {
+            heat_pixels[a] = 0xFF101010u;
+            continue;
+        }
+        const float t = std::log1p(static_cast<float>(pc_heat[a])) * norm;
+        const auto r = static_cast<uint32_t>(std::min(1.0f, t * 3.0f) * 255.0f);
+        const auto g = static_cast<uint32_t>(std::clamp(t * 3.0f - 1.0f, 0.0f, 1.0f) * 255.0f);
+        const auto b = static_cast<uint32_t>(std::clamp(t * 3.0f - 2.0f, 0.0f, 1.0f) * 255.0f);
+        heat_pixels[a] = 0xFF000000u | (r << 16) | (g << 8) | b;
+    }
+    SDL_UpdateTexture(heatmap, nullptr, heat_pixels, HEATMAP_SIDE * static_cast<int>(sizeof(uint32_t)));
+
+    int w = 0, h = 0;
+    SDL_GetRendererOutputSize(renderer, &w, &h);
+    constexpr int CELL = 4;
+    const SDL_Rect area{w - 8 - HEATMAP_SIDE * CELL, 32, HEATMAP_SIDE * CELL, HEATMAP_SIDE * CELL};
+    SDL_RenderCopy(renderer, heatmap, nullptr, &area);
+    const int at = pc - base; // the snapshot can lag the heat copy by a frame , only outline a pc that's in the window
+    if (at >= 0 && at < HEATMAP_SIDE * HEATMAP_SIDE) {
+        const SDL_Rect cursor{area.x + (at % HEATMAP_SIDE) * CELL - 1, area.y + (at / HEATMAP_SIDE) * CELL - 1, CELL + 2, CELL + 2};
+        SDL_SetRenderDrawColor(renderer, 0, 200, 255, 255);
+        SDL_RenderDrawRect(renderer, &cursor);
+    }
+    char label[32];
+    std::snprintf(label, sizeof(label), "PC heat 0x%04X-0x%04X", base, base + HEATMAP_SIDE * HEATMAP_SIDE - 1);
+    draw_debug_text(area.x, 8, label);
+}
+
+template<class S> void Graphics::upload(SDL_Texture* target, const S& screen, uint64_t dirty_rows) {
+    // upload each run of changed rows as one sub-rect , untouched rows stay in the texture from last time
+    constexpr int W = static_cast<int>(S::WIDTH);
+    constexpr int H = static_cast<int>(S::HEIGHT);
+    for (int y = 0; y < H;) {
+        if (!((dirty_rows >> y) & 1u)) {
+            ++y;
+            continue;
+        }
+        int end = y + 1;
+        while (end < H && ((dirty_rows >> end) & 1u)) ++end;
+        expand_rows(screen, y, end - y, pixels);
+        const SDL_Rect rows{0, y, W, end - y};
+        SDL_UpdateTexture(target, &rows, pixels, W * static_cast<int>(sizeof(uint32_t)));
+        y = end;
+    }
+}
+
+bool Graphics::render(bool hires,
+    const Chip8System::Lores_screen& lores_display,
+    const Chip8System::Hires_screen& hires_display,
+    uint64_t dirty_rows,
     const Chip8System::Debug_snapshot* snapshot,
     Debug::Mode mode, 
-    bool show_debug
+    bool show_debug,
+    const uint64_t* pc_heat,
+    uint16_t heat_base
 ){
-    SDL_UpdateTexture(texture, nullptr, framebuffer, WIDTH * static_cast<int>(sizeof(uint32_t)));
+    if (hires) upload(hires_texture, hires_display, dirty_rows);
+    else upload(texture, lores_display, dirty_rows);
+
+    // same picture as the last present and no overlay to refresh , leave the window alone. an open overlay only
+    // needs a present when the VM moved (a new snapshot generation) , not every frame
+    const bool overlay_stale = show_debug && (!snapshot || !overlay_valid || snapshot->generation != shown.generation
+        || snapshot->memory_base != shown.memory_base || mode != shown.mode || (pc_heat != nullptr) != heat_on_screen);
+    if (!dirty_rows && !overlay_stale && show_debug == overlay_on_screen && !needs_present) return false;
+    overlay_on_screen = show_debug;
+    heat_on_screen = show_debug && pc_heat;
+    needs_present = false;
+
     SDL_RenderClear(renderer);
-    SDL_RenderCopy(renderer,texture,nullptr,nullptr);
+    SDL_RenderCopy(renderer, hires ? hires_texture : texture, nullptr, nullptr);
     
     if(show_debug && snapshot){
         SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
         SDL_SetRenderDrawColor(renderer,0,0,0,170);
-        SDL_Rect debug_panel{8,8,360,170};
+        SDL_Rect debug_panel{8,8,360,170 + MEMORY_LINES * 16};
         SDL_RenderFillRect(renderer, &debug_panel);
-           std::ostringstream line1;
-        line1 << "PC: 0x" << std::hex << std::setw(4) << std::setfill('0') << snapshot->pc
-              << "  OP: 0x" << std::setw(4) << snapshot->opcode
-              << "  I: 0x" << std::setw(4) << snapshot->i;
-        draw_debug_text(16, 16, line1.str());
-
-        std::ostringstream line2;
-        line2 << "DT: " << std::dec << (int)snapshot->dt
-              << "  ST: " << (int)snapshot->st
-              << "  SP: " << (int)snapshot->sp
-              << "  MODE: " << (mode == Debug::Mode::Running ? "RUN" : "PAUSE");
-        draw_debug_text(16, 40, line2.str());
-
+        update_overlay_lines(*snapshot, mode);
+        draw_debug_text(16, 16, overlay_lines[0]);
+        draw_debug_text(16, 40, overlay_lines[1]);
         for (int i = 0; i < 16; ++i) {
-            std::ostringstream vr;
-            vr << "V" << std::hex << std::uppercase << i
-               << ": " << std::setw(2) << std::setfill('0')
-               << (int)snapshot->registers[i];
             int col = i / 8;
             int row = i % 8;
-            draw_debug_text(16 + col * 160, 68 + row * 16, vr.str());
-        }      
+            draw_debug_text(16 + col * 160, 68 + row * 16, overlay_lines[2 + i]);
+        }
+        for (int row = 0; row < MEMORY_LINES; ++row) draw_debug_text(16, 200 + row * 16, overlay_lines[2 + 16 + row]);
+        if (pc_heat) draw_heatmap(pc_heat, heat_base, snapshot->pc);
+        flush_text();
     }
     SDL_RenderPresent(renderer);
+    return true;
 }
 
-bool Graphics::process_input(uint8_t keys[16], 
-    uint8_t just_pressed[16] , 
-    uint8_t just_released[16],
-    Graphics::Debug_input& d
-){
+bool Graphics::process_input(Emulation_thread& emu, Graphics::Debug_input& d){
     SDL_Event e; 
     d = {}; 
-    // zero edge event arrays to prevent stale events
-    for(int i = 0 ; i < 16; ++i){
-        just_pressed[i] = 0 ;
-        just_released[i] = 0; 
-    }
+    // keypad and emulation control go to the emulation thread in order , overlay toggles stay on this thread
+    auto send = [&](Input_event::Kind kind, uint8_t key = 0) {
+        if (!emu.send(Input_event{kind, key})) std::cerr << "input queue full , dropped an event" << std::endl;
+    };
     
     while(SDL_PollEvent(&e)){
         if(e.type == SDL_QUIT) return false; //exit event
+        if(e.type == SDL_WINDOWEVENT) needs_present = true; // exposed / resized , the old present may be gone
         
         // handle esc quit and debug keys
         if (e.type == SDL_KEYDOWN && e.key.repeat == 0) {
             switch (e.key.keysym.sym) {
                 case SDLK_ESCAPE: return false;
                 case SDLK_F1:  d.show_debug = true; break;
-                case SDLK_F2:  d.flip_mode = true; break;
-                case SDLK_F3: d.step_one_cycle= true; break;
-                case SDLK_F4: d.step_one_render = true; break;
+                case SDLK_F2:  send(Input_event::Kind::Flip_mode); break;
+                case SDLK_F3: send(Input_event::Kind::Step_cycle); break;
+                case SDLK_F4: send(Input_event::Kind::Step_frame); break;
+                case SDLK_F5: d.show_heatmap = true; break;
+                case SDLK_F6: send(Input_event::Kind::Toggle_breakpoint); break;
+                case SDLK_F7: send(Input_event::Kind::Dump_trace); break;
+                case SDLK_PAGEUP: --d.memory_pages; break;
+                case SDLK_PAGEDOWN: ++d.memory_pages; break;
+                case SDLK_BACKSPACE: send(Input_event::Kind::Rewind_down); break;
+                case SDLK_TAB: send(Input_event::Kind::Turbo_down); break;
             }
         } 
+        if (e.type == SDL_KEYUP && e.key.keysym.sym == SDLK_BACKSPACE) send(Input_event::Kind::Rewind_up);
+        if (e.type == SDL_KEYUP && e.key.keysym.sym == SDLK_TAB) send(Input_event::Kind::Turbo_up);
         
         if(e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) {
             int key = getKeyMapping(e.key.keysym.sym);
             if(key >= 0){
-                if(e.type == SDL_KEYDOWN && e.key.repeat==0) {
-                    keys[key] = 1; // overall key state
-                    just_pressed[key] = 1; //edge state (pos)
-                }
-                if(e.type == SDL_KEYUP){
-                    keys[key] = 0;
-                    just_released[key] = 1; //edge state (neg)
-                }
+                if(e.type == SDL_KEYDOWN && e.key.repeat==0) send(Input_event::Kind::Key_down, static_cast<uint8_t>(key));
+                if(e.type == SDL_KEYUP) send(Input_event::Kind::Key_up, static_cast<uint8_t>(key));
             }
         }
     }
@@ -216,7 +396,13 @@ bool Graphics::process_input(uint8_t keys[16],
 }
 
 void Graphics::shutdown(){
+    if (heatmap) SDL_DestroyTexture(heatmap);
+    if (glyph_atlas) SDL_DestroyTexture(glyph_atlas);
+    heatmap = nullptr;
+    glyph_atlas = nullptr;
     if (texture) SDL_DestroyTexture(texture);
+    if (hires_texture) SDL_DestroyTexture(hires_texture);
+    hires_texture = nullptr;
     if (renderer) SDL_DestroyRenderer(renderer);
     if (window) SDL_DestroyWindow(window);
     if (audio_device) SDL_CloseAudioDevice(audio_device);
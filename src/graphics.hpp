@@ -5,40 +5,94 @@
 #include <cstdint>
 #include <atomic>
 #include <string>
+#include <array>
+#include <vector>
 
 #include "debugger.hpp"
 #include "chip8_emulator.hpp"
+#include "emulation_thread.hpp"
 
 class Graphics{
     public:
-        static constexpr int WIDTH = 64;
+        static constexpr int WIDTH = 64; // window aspect and lores texture , hires gets its own 128x64 texture
         static constexpr int HEIGHT = 32; 
+        static constexpr int HIRES_WIDTH = Chip8System::HIRES_W;
+        static constexpr int HIRES_HEIGHT = Chip8System::HIRES_H;
         static constexpr const char* DEBUG_FONT = "fonts/OCRAExt.TTF";
-        struct Debug_input{
-            bool flip_mode{false};
-            bool step_one_cycle{false};
-            bool step_one_render{false};
+        struct Debug_input{ // overlay toggles , handled on the render thread
             bool show_debug{false}; 
+            bool show_heatmap{false}; // profiling builds only
+            int memory_pages{0}; // PageUp/PageDown , memory viewer windows to move by
         };
 
         bool init(const char* title, int scale);
-        bool process_input(uint8_t keys[16], uint8_t just_pressed[16] , uint8_t just_released[16], Debug_input& dbg); 
+        bool process_input(Emulation_thread& emu, Debug_input& dbg); // false on quit
         void shutdown();
-        void render(const uint32_t* framebuffer, const Chip8System::Debug_snapshot* snapshot, Debug::Mode mode, bool show_debug); 
+        // shows lores_display or hires_display depending on hires. dirty_rows: rows of that screen that changed , only
+        // those are uploaded (all of them after a resolution switch). returns false when nothing changed and
+        // the present was skipped (there's no vsync wait then , the caller should sleep)
+        bool render(bool hires, const Chip8System::Lores_screen& lores_display, const Chip8System::Hires_screen& hires_display,
+            uint64_t dirty_rows, const Chip8System::Debug_snapshot* snapshot, Debug::Mode mode,
+            bool show_debug, const uint64_t* pc_heat = nullptr, uint16_t heat_base = 0); // pc_heat: 4096 per-address execution counts from the profiler starting at heat_base , nullptr hides the heatmap
         void set_playback(bool enabled);
     private: 
         float phase{0.0f};
         float frequency{440.0f};
         float volume{0.20f}; 
         std::atomic<bool> playback_on{false};
+        bool needs_present{true}; // window events invalidate what's on screen
+        bool overlay_on_screen{false}; // one more present after F1 closes the overlay
     
         SDL_Window* window{nullptr};
         SDL_Renderer* renderer{nullptr};
         SDL_Texture* texture{nullptr}; 
+        SDL_Texture* hires_texture{nullptr};
+        uint32_t pixels[HIRES_WIDTH * HIRES_HEIGHT]{}; // ARGB staging for either texture , expanded from the bitplanes
+        template<class S> void upload(SDL_Texture* target, const S& screen, uint64_t dirty_rows);
         SDL_AudioDeviceID audio_device{0}; // audio device 
         SDL_AudioSpec audio_spec{}; // format (int channels: 1 mono, 2 stereo, etc, int freq : sample rate)
 
         static void audio_callback(void* userdata, Uint8* stream, int len);
-        void draw_debug_text(int x , int y , const std::string& text);
+        void draw_debug_text(int x , int y , const std::string& text); // queued , drawn by flush_text()
+        void flush_text();
+        void build_glyph_atlas();
+        void update_overlay_lines(const Chip8System::Debug_snapshot& snapshot, Debug::Mode mode);
+        void draw_heatmap(const uint64_t* pc_heat, uint16_t base, uint16_t pc);
+        static constexpr int HEATMAP_SIDE = 64; // 4096 addresses as 64 rows of 64
+        SDL_Texture* heatmap{nullptr}; // created on first use
+        uint32_t heat_pixels[HEATMAP_SIDE * HEATMAP_SIDE]{};
         TTF_Font* debug_font{nullptr}; // debugger font handler
+
+        // printable ASCII rendered once into one texture , text is then just rect copies out of it
+        static constexpr char FIRST_GLYPH = ' ';
+        static constexpr char LAST_GLYPH = '~';
+        struct Glyph {
+            SDL_Rect src{};
+            int advance{0};
+        };
+        SDL_Texture* glyph_atlas{nullptr};
+        std::array<Glyph, LAST_GLYPH - FIRST_GLYPH + 1> glyphs{};
+        struct Glyph_quad {
+            SDL_Rect src;
+            SDL_Rect dst;
+        };
+        std::vector<Glyph_quad> text_batch; // queued this frame , kept around so it doesn't reallocate
+
+        // overlay text , a line is only re-formatted when the value it shows changed
+        static constexpr int MEMORY_ROW = 8; // bytes per memory viewer line
+        static constexpr int MEMORY_LINES = static_cast<int>(Chip8System::MEMORY_WINDOW) / MEMORY_ROW;
+        static constexpr int OVERLAY_LINES = 2 + 16 + MEMORY_LINES;
+        std::array<std::string, OVERLAY_LINES> overlay_lines{};
+        struct Overlay_values {
+            uint16_t pc{}, opcode{}, i{};
+            uint8_t dt{}, st{}, sp{};
+            Debug::Mode mode{Debug::Mode::Running};
+            std::array<uint8_t, Chip8System::REGISTERS> registers{};
+            uint16_t memory_base{};
+            std::array<uint8_t, Chip8System::MEMORY_WINDOW> memory{};
+            uint64_t generation{};
+        };
+        Overlay_values shown{};
+        bool overlay_valid{false};
+        bool heat_on_screen{false};
 };
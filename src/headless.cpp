@@ -0,0 +1,381 @@
+#include "batch.hpp"
+#include "chip8_emulator.hpp"
+#include "movie.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// headless runner: executes a ROM as fast as the host allows (no SDL, no pacing) and reports throughput.
+// timers still tick once per emulated frame so timer driven ROMs behave the same as in the SDL frontend.
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " <rom> [--frames N | --instructions N] [--hz N] [--timing fixed|vip] [--quirks NAME] [--engine interp|cached|jit] [--lockstep] [--no-idle-skip] [--lanes N]" << std::endl;
+    std::cerr << "       [--load-state FILE [--state-base FILE]] [--save-state FILE | --save-delta FILE] [--seed N] [--play FILE] [--profile FILE]" << std::endl;
+    std::cerr << "       [--break ADDR] [--watch FIRST[-LAST][:r|w|rw]] [--break-if VX<op>N] [--trace FILE]" << std::endl;
+    std::cerr << "  --frames N        run N emulated 60Hz frames (default 3600)" << std::endl;
+    std::cerr << "  --instructions N  run N cpu cycles instead of a frame count" << std::endl;
+    std::cerr << "  --hz N            emulated cpu speed used to split cycles into frames (default 700)" << std::endl;
+    std::cerr << "  --timing NAME     fixed (one cycle per instruction at --hz , default) or vip (COSMAC VIP instruction costs)" << std::endl;
+    std::cerr << "  --quirks NAME     auto (guess from the ROM , default) , hybrid , vip , chip48 , schip or xochip" << std::endl;
+    std::cerr << "  --engine NAME     interp (table interpreter) , cached (pre-decoded , default) or jit (x86-64 blocks)" << std::endl;
+    std::cerr << "  --lockstep        with --engine jit , check every block against the interpreter" << std::endl;
+    std::cerr << "  --no-idle-skip    execute busy-wait loops instead of skipping to the next timer tick" << std::endl;
+    std::cerr << "  --lanes N         run N copies of the ROM on the SIMD batch engine (frames only , hash is lane 0)" << std::endl;
+    std::cerr << "  --load-state FILE resume from a save state , --state-base names the full state a delta was taken against" << std::endl;
+    std::cerr << "  --save-state FILE write a full save state when the run ends" << std::endl;
+    std::cerr << "  --save-delta FILE write only what changed since the loaded state (needs --load-state)" << std::endl;
+    std::cerr << "  --seed N          CXNN rng seed (default random)" << std::endl;
+    std::cerr << "  --play FILE       replay an input movie , its seed , cpu speed and quirks win over --seed/--hz/--quirks and it sets the default frame count" << std::endl;
+    std::cerr << "  --profile FILE    write folded call stacks to FILE and a profile report to stderr (needs -DCHIP8_PROFILE=ON)" << std::endl;
+    std::cerr << "  --break ADDR      stop before executing the instruction at ADDR (hex) , repeatable" << std::endl;
+    std::cerr << "  --watch RANGE     stop before an instruction that reads/writes memory in RANGE (hex) , repeatable" << std::endl;
+    std::cerr << "  --break-if COND   stop when a register condition becomes true , e.g. v3==5 or vf!=0 , repeatable" << std::endl;
+    std::cerr << "  --trace FILE      record the last 1M instructions and write them to FILE when the run ends ," << std::endl;
+    std::cerr << "                    stops or fails. chip8_trace FILE prints them" << std::endl;
+}
+
+static std::vector<uint8_t> read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if(!in) throw std::runtime_error("can't open " + path);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void write_file(const std::string& path, const std::vector<uint8_t>& data) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    if(!out) throw std::runtime_error("can't write " + path);
+}
+
+// --lanes path: every lane runs the same ROM with no input , cycles are summed over lanes
+static int run_batch(const char* rom, std::size_t lanes, uint64_t frame_budget, uint64_t cpu_hz, uint32_t seed) {
+    Chip8Batch batch(lanes, seed);
+    batch.set_cpu_hz(cpu_hz);
+    try {
+        batch.load_ROM(rom);
+    } catch(const std::exception& ex) {
+        std::cerr << "Failed to load ROM: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t cycles = batch.step_frames(frame_budget);
+    const auto end = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>(end - start).count();
+    const double safe_elapsed = elapsed > 0.0 ? elapsed : 1e-9;
+
+    std::cout << "rom: " << rom << "\n"
+              << "lanes: " << lanes << "\n"
+              << "cycles: " << cycles << "\n"
+              << "frames: " << frame_budget << "\n"
+              << std::fixed << std::setprecision(6)
+              << "elapsed_s: " << elapsed << "\n"
+              << std::setprecision(0)
+              << "instructions_per_s: " << cycles / safe_elapsed << "\n"
+              << "frames_per_s: " << frame_budget * lanes / safe_elapsed << "\n"
+              << "framebuffer_hash: 0x" << std::hex << std::setw(16) << std::setfill('0') << batch.display_hash(0)
+              << std::endl;
+
+    // lanes promise the single VM's exact semantics: replay the first and last lane on a hybrid interpreter with
+    // the lane's seed and fail the run if either screen differs , so a decode drifting between the two can't go unseen
+    for(const std::size_t lane : {std::size_t{0}, lanes - 1}) {
+        Chip8System reference(seed + static_cast<uint32_t>(lane));
+        reference.set_engine(Chip8System::Engine::Interpreter);
+        reference.set_cpu_hz(cpu_hz);
+        try {
+            reference.load_ROM(rom);
+            reference.set_quirks(Quirk_profile::Hybrid);
+        } catch(const std::exception& ex) {
+            std::cerr << "Failed to load ROM on the reference VM: " << ex.what() << std::endl;
+            return 1;
+        }
+        try {
+            while(reference.timer_ticks() < frame_budget) reference.run_until(reference.next_tick_cycle());
+        } catch(const std::exception&) {
+            // a fault the lanes don't model is still a mismatch
+        }
+        if(reference.display_hash() != batch.display_hash(lane)) {
+            std::cerr << "lane " << std::dec << lane << " differs from the single VM: 0x" << std::hex << batch.display_hash(lane)
+                      << " vs 0x" << reference.display_hash() << std::endl;
+            return 2;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if(argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    uint64_t frame_budget = 3600;
+    bool frames_given = false;
+    uint64_t cycle_budget = 0; // 0 = run by frames
+    uint64_t cpu_hz = 700;
+    Chip8System::Timing timing = Chip8System::Timing::Fixed;
+    bool auto_quirks = true;
+    Quirk_profile quirks = Quirk_profile::Hybrid;
+    Chip8System::Engine engine = Chip8System::Engine::Cached;
+    bool lockstep = false;
+    bool idle_skip = true;
+    std::size_t lanes = 0; // 0 = single Chip8System
+    std::string load_path;
+    std::string base_path;
+    std::string save_path;
+    std::string delta_path;
+    uint32_t seed = std::random_device{}();
+    std::string movie_path;
+    std::string profile_path;
+    Breakpoints stops; // handed to the VM once it exists
+    std::string trace_path;
+
+    for(int i = 2; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+        if(std::strcmp(argv[i], "--frames") == 0 && has_value) {
+            frame_budget = std::strtoull(argv[++i], nullptr, 10);
+            frames_given = true;
+            cycle_budget = 0;
+        } else if(std::strcmp(argv[i], "--instructions") == 0 && has_value) {
+            cycle_budget = std::strtoull(argv[++i], nullptr, 10);
+        } else if(std::strcmp(argv[i], "--hz") == 0 && has_value) {
+            cpu_hz = std::strtoull(argv[++i], nullptr, 10);
+        } else if(std::strcmp(argv[i], "--timing") == 0 && has_value) {
+            const char* name = argv[++i];
+            if(std::strcmp(name, "fixed") == 0) timing = Chip8System::Timing::Fixed;
+            else if(std::strcmp(name, "vip") == 0) timing = Chip8System::Timing::Vip;
+            else {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if(std::strcmp(argv[i], "--quirks") == 0 && has_value) {
+            const char* name = argv[++i];
+            auto_quirks = std::strcmp(name, "auto") == 0;
+            if(!auto_quirks && !parse_quirk_profile(name, quirks)) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if(std::strcmp(argv[i], "--engine") == 0 && has_value) {
+            const char* name = argv[++i];
+            if(std::strcmp(name, "interp") == 0) engine = Chip8System::Engine::Interpreter;
+            else if(std::strcmp(name, "cached") == 0) engine = Chip8System::Engine::Cached;
+            else if(std::strcmp(name, "jit") == 0) engine = Chip8System::Engine::Jit;
+            else {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if(std::strcmp(argv[i], "--lockstep") == 0) {
+            lockstep = true;
+        } else if(std::strcmp(argv[i], "--no-idle-skip") == 0) {
+            idle_skip = false;
+        } else if(std::strcmp(argv[i], "--lanes") == 0 && has_value) {
+            lanes = std::strtoull(argv[++i], nullptr, 10);
+        } else if(std::strcmp(argv[i], "--load-state") == 0 && has_value) {
+            load_path = argv[++i];
+        } else if(std::strcmp(argv[i], "--state-base") == 0 && has_value) {
+            base_path = argv[++i];
+        } else if(std::strcmp(argv[i], "--save-state") == 0 && has_value) {
+            save_path = argv[++i];
+        } else if(std::strcmp(argv[i], "--save-delta") == 0 && has_value) {
+            delta_path = argv[++i];
+        } else if(std::strcmp(argv[i], "--seed") == 0 && has_value) {
+            seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if(std::strcmp(argv[i], "--play") == 0 && has_value) {
+            movie_path = argv[++i];
+        } else if(std::strcmp(argv[i], "--profile") == 0 && has_value) {
+            profile_path = argv[++i];
+        } else if(std::strcmp(argv[i], "--break") == 0 && has_value) {
+            uint16_t pc = 0;
+            if(!Breakpoints::parse_pc(argv[++i], pc)) {
+                usage(argv[0]);
+                return 1;
+            }
+            stops.set_pc(pc, true);
+        } else if(std::strcmp(argv[i], "--watch") == 0 && has_value) {
+            Breakpoints::Watch w;
+            if(!Breakpoints::parse_watch(argv[++i], w)) {
+                usage(argv[0]);
+                return 1;
+            }
+            stops.add_watch(w);
+        } else if(std::strcmp(argv[i], "--break-if") == 0 && has_value) {
+            Breakpoints::Condition c;
+            if(!Breakpoints::parse_condition(argv[++i], c)) {
+                usage(argv[0]);
+                return 1;
+            }
+            stops.add_condition(c);
+        } else if(std::strcmp(argv[i], "--trace") == 0 && has_value) {
+            trace_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    std::unique_ptr<Movie> movie;
+    if(!movie_path.empty()) {
+        try {
+            movie = std::make_unique<Movie>(Movie::load(movie_path.c_str()));
+            if(movie->rom_hash() != Movie::hash_rom(argv[1])) throw std::runtime_error("movie was recorded on a different ROM");
+        } catch(const std::exception& ex) {
+            std::cerr << "Failed to load movie: " << ex.what() << std::endl;
+            return 1;
+        }
+        if(cycle_budget || lanes || timing != Chip8System::Timing::Fixed) {
+            std::cerr << "--play runs whole fixed-speed frames on a single VM , drop --instructions/--lanes/--timing" << std::endl;
+            return 1;
+        }
+        seed = movie->seed();
+        cpu_hz = movie->cpu_hz();
+        auto_quirks = false;
+        quirks = movie->quirks();
+        if(!frames_given) frame_budget = movie->frames();
+    }
+#ifndef CHIP8_PROFILE
+    if(!profile_path.empty()) {
+        std::cerr << "--profile needs a build configured with -DCHIP8_PROFILE=ON" << std::endl;
+        return 1;
+    }
+#endif
+    if(cpu_hz == 0) {
+        std::cerr << "--hz must be greater than 0" << std::endl;
+        return 1;
+    }
+    if(!delta_path.empty() && load_path.empty()) {
+        std::cerr << "--save-delta needs a --load-state to take the delta against" << std::endl;
+        return 1;
+    }
+    if(lanes) {
+        if(timing != Chip8System::Timing::Fixed || (!auto_quirks && quirks != Quirk_profile::Hybrid)) {
+            std::cerr << "--lanes only runs fixed timing and the hybrid quirks" << std::endl;
+            return 1;
+        }
+        if(cycle_budget) {
+            std::cerr << "--lanes runs whole frames , use --frames instead of --instructions" << std::endl;
+            return 1;
+        }
+        if(stops.armed() || !trace_path.empty()) {
+            std::cerr << "--lanes has no breakpoints or tracing , drop --break/--watch/--break-if/--trace" << std::endl;
+            return 1;
+        }
+        return run_batch(argv[1], lanes, frame_budget, cpu_hz, seed);
+    }
+
+    Chip8System chip8(seed);
+    chip8.set_engine(engine);
+    chip8.set_jit_lockstep(lockstep);
+    chip8.set_idle_skip(idle_skip);
+    chip8.set_cpu_hz(cpu_hz);
+    chip8.set_timing(timing);
+    if(engine == Chip8System::Engine::Jit && chip8.current_engine() != engine) {
+        std::cerr << "JIT unavailable on this host , using the cached engine" << std::endl;
+    }
+    try {
+        chip8.load_ROM(argv[1]);
+    } catch(const std::exception& ex) {
+        std::cerr << "Failed to load ROM: " << ex.what() << std::endl;
+        return 1;
+    }
+    chip8.set_quirks(auto_quirks ? chip8.detect_rom_quirks() : quirks);
+    std::vector<uint8_t> base; // full state deltas are taken against
+    if(!load_path.empty()) {
+        try {
+            const std::vector<uint8_t> state = read_file(load_path);
+            if(!base_path.empty()) {
+                base = read_file(base_path);
+                chip8.load_state(state, &base);
+            } else {
+                chip8.load_state(state);
+                base = state;
+            }
+        } catch(const std::exception& ex) {
+            std::cerr << "Failed to load state: " << ex.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if(stops.armed()) chip8.breakpoints() = stops;
+    chip8.set_tracing(!trace_path.empty());
+    auto save_trace = [&] {
+        if(trace_path.empty()) return;
+        try {
+            chip8.trace()->save(trace_path.c_str());
+        } catch(const std::exception& ex) {
+            std::cerr << "Failed to write trace: " << ex.what() << std::endl;
+        }
+    };
+
+    uint64_t cycles = 0; // instructions , equal to the clock with fixed timing
+    std::string stopped; // what a breakpoint stopped the run on
+    const auto start = std::chrono::steady_clock::now();
+
+    // the VM's cycle clock splits cpu_hz over 60 frames per second , so 700Hz gives 11/12 cycle frames with no drift
+    try {
+        while(cycle_budget ? chip8.cycles() < cycle_budget : chip8.timer_ticks() < frame_budget) {
+            uint64_t frame_end = chip8.next_tick_cycle();
+            if(cycle_budget && frame_end > cycle_budget) frame_end = cycle_budget;
+            if(movie) movie->apply(chip8, chip8.timer_ticks());
+            cycles += chip8.run_until(frame_end);
+            if(chip8.break_pending()) {
+                stopped = chip8.breakpoints().describe(chip8.breakpoints().last_hit());
+                break;
+            }
+        }
+    } catch(const std::exception& ex) {
+        std::cerr << "Run failed after " << cycles << " cycles: " << ex.what() << std::endl;
+        save_trace(); // what led up to it
+        return 1;
+    }
+    const uint64_t frames = chip8.timer_ticks();
+
+    const auto end = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>(end - start).count();
+    const double safe_elapsed = elapsed > 0.0 ? elapsed : 1e-9;
+    save_trace();
+
+    try {
+        if(!delta_path.empty()) write_file(delta_path, chip8.save_delta(base));
+        if(!save_path.empty()) write_file(save_path, chip8.save_state());
+    } catch(const std::exception& ex) {
+        std::cerr << "Failed to save state: " << ex.what() << std::endl;
+        return 1;
+    }
+#ifdef CHIP8_PROFILE
+    if(!profile_path.empty()) {
+        std::ofstream folded(profile_path);
+        chip8.profiler().write_folded(folded);
+        if(!folded) {
+            std::cerr << "Failed to write profile " << profile_path << std::endl;
+            return 1;
+        }
+        chip8.profiler().write_report(std::cerr);
+    }
+#endif
+
+    std::cout << "rom: " << argv[1] << "\n"
+              << "seed: " << seed << "\n"
+              << "quirks: " << quirk_name(chip8.current_quirks()) << "\n"
+              << "cycles: " << cycles << "\n"
+              << "clock_cycles: " << chip8.cycles() << "\n"
+              << "idle_cycles_elided: " << chip8.idle_cycles_elided() << "\n"
+              << "frames: " << frames << "\n";
+    if(!stopped.empty()) std::cout << "break: " << stopped << "\n";
+    std::cout << std::fixed << std::setprecision(6)
+              << "elapsed_s: " << elapsed << "\n"
+              << std::setprecision(0)
+              << "instructions_per_s: " << cycles / safe_elapsed << "\n"
+              << "frames_per_s: " << frames / safe_elapsed << "\n"
+              << "framebuffer_hash: 0x" << std::hex << std::setw(16) << std::setfill('0') << chip8.display_hash()
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,330 @@
+#include "jit.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define CHIP8_JIT_X64 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// register contract for generated code (SysV):
+//   rdi = registers (V0..VF) , rsi = &index_reg , rdx = &delay_timer , rcx = &sound_timer
+//   eax/r8 are scratch , eax holds the next pc on return
+namespace {
+
+struct Emitter {
+    uint8_t* out;
+    std::size_t used{0};
+    std::size_t capacity;
+
+    void b(uint8_t v) {out[used++] = v;}
+    void w(uint16_t v) {b(v & 0xFFu); b(v >> 8);}
+    void d(uint32_t v) {w(v & 0xFFFFu); w(v >> 16);}
+
+    void mov_v_imm(uint8_t x, uint8_t imm) {b(0xC6); b(0x47); b(x); b(imm);} // mov byte [rdi+x], imm
+    void add_v_imm(uint8_t x, uint8_t imm) {b(0x80); b(0x47); b(x); b(imm);} // add byte [rdi+x], imm
+    void cmp_v_imm(uint8_t x, uint8_t imm) {b(0x80); b(0x7F); b(x); b(imm);} // cmp byte [rdi+x], imm
+    void al_op_v(uint8_t op, uint8_t x) {b(op); b(0x47); b(x);} // mov/add/sub/cmp al, [rdi+x] or [rdi+x], al forms
+    void load_al(uint8_t x) {al_op_v(0x8A, x);}
+    void store_al(uint8_t x) {al_op_v(0x88, x);}
+    void movzx_eax_v(uint8_t x) {b(0x0F); b(0xB6); b(0x47); b(x);}
+    void set_flag(bool carry) {b(0x41); b(0x0F); b(carry ? 0x92 : 0x93); b(0xC0);} // setc / setnc r8b
+    void store_flag() {b(0x44); b(0x88); b(0x47); b(0x0F);} // mov [rdi+15], r8b
+    void mov_eax_imm(uint32_t imm) {b(0xB8); d(imm);}
+    void ret() {b(0xC3);}
+
+    // eax = cond ? skip : next , flags already set by a cmp
+    void select_pc(bool skip_if_equal, uint16_t next) {
+        mov_eax_imm(next);
+        b(0x41); b(0xB8); d(next + 2u); // mov r8d, next+2
+        b(0x41); b(0x0F); b(skip_if_equal ? 0x44 : 0x45); b(0xC0); // cmove/cmovne eax, r8d
+        ret();
+    }
+};
+
+// worst case bytes for one instruction plus the block epilogue
+constexpr std::size_t MAX_OP_BYTES = 24;
+constexpr std::size_t EPILOGUE_BYTES = 6;
+
+enum class Emit : uint8_t {
+    Straight, // compiled , keep going
+    End, // compiled a block ending instruction , code already returns
+    Unsupported // leave it to the interpreter
+};
+
+// quirk dependent ops follow the VM's profile , the same choices its templated handlers make
+Emit emit_op(Emitter& e, uint16_t op, uint16_t pc, const Quirk_flags& quirks) {
+    const uint8_t x = (op & 0x0F00u) >> 8u;
+    const uint8_t y = (op & 0x00F0u) >> 4u;
+    const uint8_t nn = op & 0x00FFu;
+    const uint16_t nnn = op & 0x0FFFu;
+    const uint16_t next = pc + 2u;
+
+    // XO-CHIP skips are 4 bytes over F000 NNNN , which depends on memory outside the block
+    const uint8_t group = op >> 12;
+    if(quirks.xochip_ops && (group == 0x3 || group == 0x4 || group == 0x5 || group == 0x9)) return Emit::Unsupported;
+
+    switch(op >> 12) {
+        case 0x1: // JP addr
+            e.mov_eax_imm(nnn);
+            e.ret();
+            return Emit::End;
+        case 0x3: // SE Vx, byte
+            e.cmp_v_imm(x, nn);
+            e.select_pc(true, next);
+            return Emit::End;
+        case 0x4: // SNE Vx, byte
+            e.cmp_v_imm(x, nn);
+            e.select_pc(false, next);
+            return Emit::End;
+        case 0x5: // SE Vx, Vy
+            if((op & 0x000Fu) != 0) return Emit::Unsupported;
+            e.load_al(x);
+            e.al_op_v(0x3A, y); // cmp al, [rdi+y]
+            e.select_pc(true, next);
+            return Emit::End;
+        case 0x9: // SNE Vx, Vy
+            if((op & 0x000Fu) != 0) return Emit::Unsupported;
+            e.load_al(x);
+            e.al_op_v(0x3A, y);
+            e.select_pc(false, next);
+            return Emit::End;
+        case 0x6:
+            e.mov_v_imm(x, nn);
+            return Emit::Straight;
+        case 0x7:
+            e.add_v_imm(x, nn);
+            return Emit::Straight;
+        case 0x8:
+            switch(op & 0x000Fu) {
+                case 0x0:
+                    e.load_al(y);
+                    e.store_al(x);
+                    return Emit::Straight;
+                case 0x1: case 0x2: case 0x3: {
+                    // or/and/xor [rdi+x], al then VF = 0 , same order as the interpreter
+                    static constexpr uint8_t logic_ops[] = {0x08, 0x20, 0x30};
+                    e.load_al(y);
+                    e.al_op_v(logic_ops[(op & 0x000Fu) - 1], x);
+                    if(quirks.vf_reset) e.mov_v_imm(0xF, 0);
+                    return Emit::Straight;
+                }
+                case 0x4:
+                    e.load_al(x);
+                    e.al_op_v(0x02, y); // add al, [rdi+y]
+                    e.set_flag(true);
+                    e.store_al(x);
+                    e.store_flag();
+                    return Emit::Straight;
+                case 0x5:
+                    e.load_al(x);
+                    e.al_op_v(0x2A, y); // sub al, [rdi+y] , no borrow means Vx >= Vy
+                    e.set_flag(false);
+                    e.store_al(x);
+                    e.store_flag();
+                    return Emit::Straight;
+                case 0x6:
+                    e.load_al(quirks.shift_vy ? y : x);
+                    e.b(0xD0); e.b(0xE8); // shr al, 1
+                    e.set_flag(true);
+                    e.store_al(x);
+                    e.store_flag();
+                    return Emit::Straight;
+                case 0x7:
+                    e.load_al(y);
+                    e.al_op_v(0x2A, x); // sub al, [rdi+x]
+                    e.set_flag(false);
+                    e.store_al(x);
+                    e.store_flag();
+                    return Emit::Straight;
+                case 0xE:
+                    e.load_al(quirks.shift_vy ? y : x);
+                    e.b(0xD0); e.b(0xE0); // shl al, 1
+                    e.set_flag(true);
+                    e.store_al(x);
+                    e.store_flag();
+                    return Emit::Straight;
+                default:
+                    return Emit::Unsupported;
+            }
+        case 0xA:
+            e.b(0x66); e.b(0xC7); e.b(0x06); e.w(nnn); // mov word [rsi], nnn
+            return Emit::Straight;
+        case 0xB: // JP V0, addr (or VX with jump_vx)
+            e.movzx_eax_v(quirks.jump_vx ? x : 0);
+            e.b(0x05); e.d(nnn); // add eax, nnn
+            e.ret();
+            return Emit::End;
+        case 0xF:
+            switch(nn) {
+                case 0x07:
+                    e.b(0x8A); e.b(0x02); // mov al, [rdx]
+                    e.store_al(x);
+                    return Emit::Straight;
+                case 0x15:
+                    e.load_al(x);
+                    e.b(0x88); e.b(0x02); // mov [rdx], al
+                    return Emit::Straight;
+                case 0x18:
+                    e.load_al(x);
+                    e.b(0x88); e.b(0x01); // mov [rcx], al
+                    return Emit::Straight;
+                case 0x1E:
+                    e.movzx_eax_v(x);
+                    e.b(0x66); e.b(0x01); e.b(0x06); // add [rsi], ax
+                    return Emit::Straight;
+                case 0x29:
+                    e.movzx_eax_v(x);
+                    e.b(0x8D); e.b(0x84); e.b(0x80); e.d(Chip8System::FONTS_START_ADDRESS); // lea eax, [rax+rax*4+fonts]
+                    e.b(0x66); e.b(0x89); e.b(0x06); // mov [rsi], ax
+                    return Emit::Straight;
+                default:
+                    return Emit::Unsupported;
+            }
+        default:
+            // 0 (cls/ret/call out), 2NNN , C , D , E and memory ops stay in the interpreter
+            return Emit::Unsupported;
+    }
+}
+
+} // namespace
+
+Jit::Jit() {
+#ifdef CHIP8_JIT_X64
+    // never writable and executable at once: the cache is read+exec , compile() opens just the pages it emits into
+    void* mem = mmap(nullptr, CODE_CACHE_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(mem == MAP_FAILED) return;
+    code_buffer = static_cast<uint8_t*>(mem);
+    const long page = sysconf(_SC_PAGESIZE);
+    page_size = page > 0 ? static_cast<std::size_t>(page) : 4096;
+    // hosts that refuse to flip a page back to exec after writing it get no jit at all
+    if(!protect(0, 1, true) || !protect(0, 1, false)) {
+        munmap(code_buffer, CODE_CACHE_SIZE);
+        code_buffer = nullptr;
+    }
+#endif
+}
+
+bool Jit::protect(std::size_t from, std::size_t to, bool writable) {
+#ifdef CHIP8_JIT_X64
+    const std::size_t first = from / page_size * page_size;
+    const std::size_t last = std::min(CODE_CACHE_SIZE, (to + page_size - 1) / page_size * page_size);
+    return mprotect(code_buffer + first, last - first, writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) == 0;
+#else
+    (void)from;
+    (void)to;
+    (void)writable;
+    return false;
+#endif
+}
+
+Jit::~Jit() {
+#ifdef CHIP8_JIT_X64
+    if(code_buffer) munmap(code_buffer, CODE_CACHE_SIZE);
+#endif
+}
+
+void Jit::set_quirks(const Quirk_flags& flags) {
+    quirks = flags;
+    flush();
+}
+
+void Jit::flush() {
+    blocks.fill(Block{});
+    code_bytes.fill(0);
+    code_used = 0;
+}
+
+const Jit::Block& Jit::lookup(const uint8_t* const* pages, uint16_t pc) {
+    Block& block = blocks[pc];
+    if(!block.compiled) compile(pages, pc, block);
+    return block;
+}
+
+void Jit::compile(const uint8_t* const* pages, uint16_t pc, Block& block) {
+    // worst case block has to fit , otherwise start over with an empty cache
+    const std::size_t worst = MAX_BLOCK * MAX_OP_BYTES + EPILOGUE_BYTES;
+    if(code_used + worst > CODE_CACHE_SIZE) flush();
+    // the pages this block can land in are writable (and not executable) only until it's sealed below
+    const bool writable = protect(code_used, code_used + worst, true);
+
+    Emitter e{code_buffer + code_used, 0, CODE_CACHE_SIZE - code_used};
+    uint16_t address = pc;
+    uint16_t last_opcode = 0;
+    uint8_t length = 0;
+    bool ended = false;
+    bool polls = false;
+
+    while(writable && length < MAX_BLOCK && address + 1u < MEMORY_SIZE) {
+        constexpr std::size_t PAGE = Chip8System::MEMORY_PAGE_SIZE;
+        const uint16_t op = pages[address / PAGE][address % PAGE] << 8u | pages[(address + 1) / PAGE][(address + 1) % PAGE];
+        const std::size_t mark = e.used;
+        const Emit result = emit_op(e, op, address, quirks);
+        if(result == Emit::Unsupported) {
+            e.used = mark;
+            break;
+        }
+        last_opcode = op;
+        polls |= (op & 0xF0FFu) == 0xF007u;
+        ++length;
+        address += 2;
+        if(result == Emit::End) {
+            ended = true;
+            break;
+        }
+    }
+
+    if(length && !ended) {
+        e.mov_eax_imm(address);
+        e.ret();
+    }
+    // back to read+exec before anything can call into it , a block that can't be sealed is never run
+    const bool sealed = writable && protect(code_used, code_used + worst, false);
+    block.compiled = true;
+    if(length == 0 || !sealed) {
+        // remember that this pc starts with something we can't compile so we don't retry every time
+        block.code = nullptr;
+        block.end = pc + 2u;
+        mark_code(pc, block.end);
+        return;
+    }
+    block.code = reinterpret_cast<Block_func>(code_buffer + code_used);
+    block.end = address;
+    block.last_opcode = last_opcode;
+    block.length = length;
+    block.polls = polls;
+    code_used += e.used;
+    mark_code(pc, block.end);
+}
+
+void Jit::mark_code(uint16_t start, uint16_t end) {
+    for(uint16_t a = start; a < end && a < MEMORY_SIZE; ++a) code_bytes[a >> 6] |= 1ull << (a & 63u);
+}
+
+void Jit::invalidate(uint16_t address, std::size_t length) {
+    // most FX33/FX55 writes land in data , the bitmap lets those skip the block scan
+    std::size_t last = address + length;
+    if(last > MEMORY_SIZE) last = MEMORY_SIZE;
+    bool hit = false;
+    for(std::size_t a = address; a < last; ++a) {
+        if(code_bytes[a >> 6] & (1ull << (a & 63u))) {
+            hit = true;
+            break;
+        }
+    }
+    if(!hit) return;
+
+    code_bytes.fill(0);
+    for(std::size_t i = 0; i < blocks.size(); ++i) {
+        Block& block = blocks[i];
+        if(!block.compiled) continue;
+        const std::size_t start = i;
+        if(start < last && address < block.end) {
+            block = Block{};
+            continue;
+        }
+        mark_code(start, block.end);
+    }
+    // generated code is only reclaimed on flush , dead blocks just sit in the buffer until then
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+
+#include "chip8_emulator.hpp"
+
+// x86-64 dynamic recompiler for straight-line CHIP-8 blocks.
+// blocks only touch registers , I and the timers , anything touching memory , the display , the stack
+// or input ends the block and runs through the interpreter instead.
+class Jit {
+    public:
+        static constexpr std::size_t MEMORY_SIZE = Chip8System::MEMORY_SIZE;
+        static constexpr std::size_t CODE_CACHE_SIZE = 1 << 20; // 1MB of generated code before we flush
+        static constexpr std::size_t MAX_BLOCK = 8; // instructions per block , short enough to fit a 700Hz frame's 11-12 cycle budget
+
+        // generated code signature , returns the pc to continue at
+        using Block_func = uint16_t(*)(uint8_t* registers, uint16_t* index_reg, uint8_t* delay_timer, uint8_t* sound_timer);
+
+        struct Block {
+            Block_func code{nullptr}; // nullptr with compiled == true means the first op can't be compiled
+            uint16_t end{}; // one past the last byte the block was translated from
+            uint16_t last_opcode{}; // for the debugger's opcode readout
+            uint8_t length{}; // instructions executed per call , the same on every path
+            bool polls{false}; // reads the delay timer (FX07) , so it can be a wait loop for idle skip
+            bool compiled{false};
+        };
+
+        Jit();
+        ~Jit();
+        Jit(const Jit&) = delete;
+        Jit& operator=(const Jit&) = delete;
+
+        bool available() const {return code_buffer != nullptr;} // false on non x86-64 hosts or if the mapping failed
+        // pages: Chip8System's page table (MEMORY_PAGE_SIZE bytes each). compiles on first use , pc + 1 must be in range
+        const Block& lookup(const uint8_t* const* pages, uint16_t pc);
+        void invalidate(uint16_t address, std::size_t length);
+        void flush();
+        void set_quirks(const Quirk_flags& flags); // flushes , blocks compiled for the old profile would be wrong
+
+    private:
+        uint8_t* code_buffer{nullptr}; // read+exec except while compile() writes into it
+        std::size_t code_used{0};
+        std::size_t page_size{4096};
+        Quirk_flags quirks{quirk_flags_of<Quirks_hybrid>()};
+        std::array<Block, MEMORY_SIZE> blocks{}; // keyed by pc , odd pcs included
+        std::array<uint64_t, MEMORY_SIZE / 64> code_bytes{}; // bitmap of addresses covered by a compiled block
+
+        void compile(const uint8_t* const* pages, uint16_t pc, Block& block);
+        bool protect(std::size_t from, std::size_t to, bool writable); // the pages covering [from , to)
+        void mark_code(uint16_t start, uint16_t end);
+};
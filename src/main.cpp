@@ -1,18 +1,107 @@
 #include "chip8_emulator.hpp"
 #include "graphics.hpp"
-#include "debugger.hpp"
-#include <chrono>
+#include "emulation_thread.hpp"
+#include "movie.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+
+// rows of screen that differ from shown , any plane or word
+template<class S> static uint64_t changed_rows(const S& screen, const S& shown) {
+    uint64_t rows = 0;
+    for (std::size_t p = 0; p < Chip8System::PLANES; ++p) {
+        for (std::size_t y = 0; y < S::HEIGHT; ++y) {
+            for (std::size_t w = 0; w < S::WORDS; ++w) rows |= static_cast<uint64_t>(screen.rows[p][y][w] != shown.rows[p][y][w]) << y;
+        }
+    }
+    return rows;
+}
 
 int main(int argc, char** argv) {
     if(argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <rom>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <rom> [--hz N] [--timing fixed|vip] [--quirks NAME] [--seed N] [--record FILE | --play FILE] [--profile FILE]"
+            << " [--break ADDR] [--watch FIRST[-LAST][:r|w|rw]] [--break-if VX<op>N] [--trace FILE]" << std::endl;
+        return 1;
+    }
+
+    constexpr double TIMER_HZ = Emulation_thread::TIMER_HZ;
+    constexpr int IDLE_WAIT_MS = 250; // still wake now and then to notice a crashed emulation thread
+
+    uint64_t cpu_hz = 700;
+    Chip8System::Timing timing = Chip8System::Timing::Fixed;
+    bool auto_quirks = true; // pick the profile from the ROM
+    Quirk_profile quirks = Quirk_profile::Hybrid;
+    uint32_t seed = std::random_device{}();
+    std::string record_path;
+    std::string profile_path; // folded call stacks written on exit (profiling builds)
+    std::unique_ptr<Movie> movie; // recorded into , or played back from
+    bool playing = false;
+    Breakpoints stops; // armed before the emulation thread starts
+    std::string trace_path; // tracing on , F7 / a watchpoint / a crash write the ring here
+    try {
+        for(int i = 2; i < argc; ++i) {
+            const bool has_value = i + 1 < argc;
+            if(std::strcmp(argv[i], "--hz") == 0 && has_value) {
+                cpu_hz = std::strtoull(argv[++i], nullptr, 10);
+                if(cpu_hz == 0) throw std::runtime_error("--hz must be greater than 0");
+            } else if(std::strcmp(argv[i], "--timing") == 0 && has_value) {
+                const char* name = argv[++i];
+                if(std::strcmp(name, "fixed") == 0) timing = Chip8System::Timing::Fixed;
+                else if(std::strcmp(name, "vip") == 0) timing = Chip8System::Timing::Vip;
+                else throw std::runtime_error(std::string("unknown timing ") + name);
+            } else if(std::strcmp(argv[i], "--quirks") == 0 && has_value) {
+                const char* name = argv[++i];
+                auto_quirks = std::strcmp(name, "auto") == 0;
+                if(!auto_quirks && !parse_quirk_profile(name, quirks)) throw std::runtime_error(std::string("unknown quirk profile ") + name);
+            } else if(std::strcmp(argv[i], "--seed") == 0 && has_value) {
+                seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            } else if(std::strcmp(argv[i], "--record") == 0 && has_value) {
+                record_path = argv[++i];
+            } else if(std::strcmp(argv[i], "--play") == 0 && has_value) {
+                movie = std::make_unique<Movie>(Movie::load(argv[++i]));
+                if(movie->rom_hash() != Movie::hash_rom(argv[1])) throw std::runtime_error("movie was recorded on a different ROM");
+                seed = movie->seed();
+                cpu_hz = movie->cpu_hz();
+                playing = true;
+            } else if(std::strcmp(argv[i], "--profile") == 0 && has_value) {
+                profile_path = argv[++i];
+#ifndef CHIP8_PROFILE
+                throw std::runtime_error("--profile needs a build configured with -DCHIP8_PROFILE=ON");
+#endif
+            } else if(std::strcmp(argv[i], "--break") == 0 && has_value) {
+                uint16_t pc = 0;
+                if(!Breakpoints::parse_pc(argv[++i], pc)) throw std::runtime_error(std::string("bad breakpoint address ") + argv[i]);
+                stops.set_pc(pc, true);
+            } else if(std::strcmp(argv[i], "--watch") == 0 && has_value) {
+                Breakpoints::Watch w;
+                if(!Breakpoints::parse_watch(argv[++i], w)) throw std::runtime_error(std::string("bad watch range ") + argv[i]);
+                stops.add_watch(w);
+            } else if(std::strcmp(argv[i], "--break-if") == 0 && has_value) {
+                Breakpoints::Condition c;
+                if(!Breakpoints::parse_condition(argv[++i], c)) throw std::runtime_error(std::string("bad break condition ") + argv[i]);
+                stops.add_condition(c);
+            } else if(std::strcmp(argv[i], "--trace") == 0 && has_value) {
+                trace_path = argv[++i];
+            } else {
+                std::cerr << "Usage: " << argv[0] << " <rom> [--hz N] [--timing fixed|vip] [--quirks NAME] [--seed N] [--record FILE | --play FILE] [--profile FILE]"
+            << " [--break ADDR] [--watch FIRST[-LAST][:r|w|rw]] [--break-if VX<op>N] [--trace FILE]" << std::endl;
+                return 1;
+            }
+        }
+        if(!record_path.empty() && playing) throw std::runtime_error("--record and --play can't be combined");
+        if((movie || !record_path.empty()) && timing != Chip8System::Timing::Fixed) throw std::runtime_error("movies only record fixed timing");
+    } catch(const std::exception& ex) {
+        std::cerr << "Bad arguments: " << ex.what() << std::endl;
         return 1;
     }
 
-    Chip8System chip8;
-    Debug debugger; 
+    Chip8System chip8(seed);
     Graphics gfx;
 
     if(!gfx.init("CHIP-8", 12)) {
@@ -22,66 +111,116 @@ int main(int argc, char** argv) {
 
     try {
         chip8.load_ROM(argv[1]);
+        // a movie replays on the profile it was recorded with , a new recording stores the one picked here
+        if(playing) chip8.set_quirks(movie->quirks());
+        else chip8.set_quirks(auto_quirks ? chip8.detect_rom_quirks() : quirks);
+        if(!record_path.empty()) {
+            movie = std::make_unique<Movie>(seed, static_cast<uint32_t>(cpu_hz), chip8.current_quirks(), Movie::hash_rom(argv[1]));
+        }
     } catch(const std::exception& ex) {
         std::cerr << "Failed to load ROM: " << ex.what() << std::endl;
         gfx.shutdown();
         return 1;
     }
 
-    constexpr double CPU_HZ = 700.0;
-    constexpr double TIMER_HZ = 60.0;
-    constexpr double CPU_STEP = 1.0 / CPU_HZ;
-    constexpr double TIMER_STEP = 1.0 / TIMER_HZ;
+    // the VM runs on its own thread in whole 60Hz frames on its cycle clock (so a recording replays exactly) ,
+    // this thread only polls input and presents the newest frame it published
+    chip8.set_cpu_hz(cpu_hz);
+    chip8.set_timing(timing);
+    if(stops.armed()) chip8.breakpoints() = stops;
+    chip8.set_tracing(!trace_path.empty());
+    Emulation_thread emu(chip8, movie.get(), playing);
+    emu.dump_trace_to(trace_path);
+    emu.start();
 
     bool running = true;
-    double cpu_acc = 0.0;
-    double timer_acc = 0.0;
-    auto last_time = std::chrono::steady_clock::now();
     bool show_debug = false; 
+    bool show_heatmap = false;
+    uint16_t memory_window = Chip8System::START_ADDRESS; // memory viewer position , paged in whole windows
+    // what was last uploaded to the textures
+    bool on_screen_hires = false;
+    auto on_screen_lores = std::make_unique<Chip8System::Lores_screen>();
+    auto on_screen_hi = std::make_unique<Chip8System::Hires_screen>();
+    uint64_t on_screen_generation = 0;
+    bool uploaded = false;
 
-    while(running) {
-        const auto now = std::chrono::steady_clock::now();
-        const double dt = std::chrono::duration<double>(now - last_time).count();
-        last_time = now;
-
-        cpu_acc += dt;
-        timer_acc += dt;
-
-        
-        Graphics::Debug_input d{}; // pass debugger to collect debug state  from user 
-        running = gfx.process_input(chip8.keys, chip8.just_pressed, chip8.just_released,d);
-
+    while(running && !emu.crashed()) {
+        Graphics::Debug_input d{};
+        running = gfx.process_input(emu, d);
         if(d.show_debug) show_debug = !show_debug; 
-        if (d.flip_mode) debugger.flip_mode();
-        if (d.step_one_cycle) debugger.step_one_cycle();
-        if (d.step_one_render) debugger.step_one_render();
-        
+        if(d.show_heatmap) show_heatmap = !show_heatmap;
 
-        while (cpu_acc >= CPU_STEP) {
-            if (debugger.can_execute_cycle()) {
-                chip8.cycle();
-            }
-            cpu_acc -= CPU_STEP;
+        // the emulation thread may have published several frames since the last present , diff against what's on screen
+        const Emulation_thread::Frame& frame = emu.newest_frame();
+        if(d.memory_pages && frame.has_snapshot) {
+            // page from where the window actually is (the snapshot clamps it to the ROM's 4KB or 64KB) , unless
+            // the last move hasn't come back yet
+            constexpr int WINDOW = static_cast<int>(Chip8System::MEMORY_WINDOW);
+            const int from = frame.memory_window == memory_window ? frame.snapshot.memory_base : memory_window;
+            memory_window = static_cast<uint16_t>(std::clamp(from + d.memory_pages * WINDOW, 0,
+                static_cast<int>(Chip8System::XO_MEMORY_SIZE) - WINDOW));
         }
-
-        while (timer_acc >= TIMER_STEP) {
-            if (debugger.can_tick_timers()) {
-                chip8.tick_timers();
-                gfx.set_playback(chip8.sound_active());
+        emu.request_snapshot(show_debug);
+        emu.request_heatmap(show_heatmap);
+        emu.request_memory_window(memory_window);
+        uint64_t dirty_rows = 0;
+        if(!uploaded || frame.generation != on_screen_generation) {
+            // a resolution switch re-uploads the whole texture it switched to
+            const bool fresh = !uploaded || frame.hires != on_screen_hires;
+            if(frame.hires) {
+                dirty_rows = fresh ? ~0ull : changed_rows(frame.hires_display, *on_screen_hi);
+                *on_screen_hi = frame.hires_display;
+            } else {
+                dirty_rows = fresh ? ~0ull : changed_rows(frame.lores_display, *on_screen_lores);
+                *on_screen_lores = frame.lores_display;
             }
-            timer_acc -= TIMER_STEP;
+            on_screen_hires = frame.hires;
+            on_screen_generation = frame.generation;
+            uploaded = true;
         }
+        gfx.set_playback(frame.sound);
 
-        Chip8System::Debug_snapshot snapshot{}; 
-        const Chip8System::Debug_snapshot* snapshot_ptr; 
-        if(show_debug) {
-            snapshot = chip8.snapshot(); 
-            snapshot_ptr = &snapshot;
+        const uint64_t* pc_heat = nullptr;
+        uint16_t heat_base = 0;
+#ifdef CHIP8_PROFILE
+        if(show_heatmap && frame.has_heat) {
+            pc_heat = frame.pc_heat.data();
+            heat_base = frame.heat_base;
+        }
+#endif
+        const Chip8System::Debug_snapshot* snapshot = show_debug && frame.has_snapshot ? &frame.snapshot : nullptr;
+        const bool presented = gfx.render(frame.hires, frame.lores_display, frame.hires_display, dirty_rows, snapshot, frame.mode,
+            show_debug, pc_heat, heat_base);
+        if(!presented) {
+            // a skipped present doesn't block on vsync. when the emulation thread is asleep on a key wait (or paused)
+            // and has seen everything we sent , only a new SDL event can change the picture , so block on one.
+            // otherwise wait about half a frame (or less , if an event comes first) instead of spinning
+            bool settled = frame.suspended && frame.events_seen == emu.events_sent() && frame.has_snapshot == show_debug
+                && frame.memory_window == memory_window;
+#ifdef CHIP8_PROFILE
+            settled = settled && frame.has_heat == show_heatmap;
+#endif
+            SDL_WaitEventTimeout(nullptr, settled ? IDLE_WAIT_MS : static_cast<int>(500.0 / TIMER_HZ));
         }
-
-        gfx.render(chip8.display, snapshot_ptr, debugger.current_mode(), show_debug);
-        debugger.on_frame_presented();
     }
+    emu.stop();
     gfx.shutdown();
+#ifdef CHIP8_PROFILE
+    if(!profile_path.empty()) {
+        std::ofstream folded(profile_path);
+        chip8.profiler().write_folded(folded);
+        if(!folded) std::cerr << "Failed to write profile " << profile_path << std::endl;
+        chip8.profiler().write_report(std::cout);
+    }
+#endif
+    if(!record_path.empty()) {
+        try {
+            movie->save(record_path.c_str());
+            std::cout << "recorded " << movie->frames() << " frames (seed " << seed << ") to " << record_path << std::endl;
+        } catch(const std::exception& ex) {
+            std::cerr << "Failed to save movie: " << ex.what() << std::endl;
+            return 1;
+        }
+    }
     return 0;
 }
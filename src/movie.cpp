@@ -0,0 +1,141 @@
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#include "movie.hpp"
+
+// file layout , little endian:
+//   "C8MV" , u16 version , u32 seed , u32 cpu hz , u8 quirk profile , u64 ROM FNV-1a , u32 frame count
+//   then runs until frame count is covered: varint run length , u16 keys , u16 just_pressed , u16 just_released
+
+namespace {
+
+constexpr char MOVIE_MAGIC[4] = {'C', '8', 'M', 'V'};
+
+template<class T> void put(std::vector<uint8_t>& out, T value) {
+    for(std::size_t i = 0; i < sizeof(T); ++i) out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i)));
+}
+
+class Reader {
+    public:
+        explicit Reader(const std::vector<uint8_t>& in) : in(in) {}
+        template<class T> T get() {
+            if(in.size() - pos < sizeof(T)) throw std::runtime_error("movie truncated");
+            uint64_t value = 0;
+            for(std::size_t i = 0; i < sizeof(T); ++i) value |= static_cast<uint64_t>(in[pos++]) << (8 * i);
+            return static_cast<T>(value);
+        }
+        uint64_t varint() {
+            uint64_t value = 0;
+            for(unsigned shift = 0; shift < 64; shift += 7) {
+                const uint8_t b = get<uint8_t>();
+                value |= static_cast<uint64_t>(b & 0x7F) << shift;
+                if(!(b & 0x80)) return value;
+            }
+            throw std::runtime_error("movie run length too long");
+        }
+        bool done() const {return pos == in.size();}
+
+    private:
+        const std::vector<uint8_t>& in;
+        std::size_t pos{0};
+};
+
+uint16_t pack(const uint8_t* keys) {
+    uint16_t mask = 0;
+    for(std::size_t k = 0; k < Chip8System::INPUT_SIZE; ++k) mask |= static_cast<uint16_t>(keys[k] != 0) << k;
+    return mask;
+}
+
+void unpack(uint16_t mask, uint8_t* keys) {
+    for(std::size_t k = 0; k < Chip8System::INPUT_SIZE; ++k) keys[k] = (mask >> k) & 1u;
+}
+
+std::vector<uint8_t> read_all(const char* path) {
+    std::ifstream in(path, std::ios::binary);
+    if(!in) throw std::runtime_error(std::string("can't open ") + path);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+} // namespace
+
+uint64_t Movie::hash_rom(const char* path) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for(const uint8_t b : read_all(path)) {
+        hash ^= b;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+Movie Movie::load(const char* path) {
+    const std::vector<uint8_t> data = read_all(path);
+    Reader in(data);
+    for(const char c : MOVIE_MAGIC) {
+        if(in.get<uint8_t>() != static_cast<uint8_t>(c)) throw std::runtime_error("not a chip8 movie");
+    }
+    const uint16_t version = in.get<uint16_t>();
+    if(version != VERSION) throw std::runtime_error("unsupported movie version " + std::to_string(version));
+
+    Movie movie;
+    movie.rng_seed = in.get<uint32_t>();
+    movie.hz = in.get<uint32_t>();
+    const uint8_t profile = in.get<uint8_t>();
+    if(profile > static_cast<uint8_t>(Quirk_profile::Xochip)) throw std::runtime_error("unknown movie quirk profile " + std::to_string(profile));
+    movie.profile = static_cast<Quirk_profile>(profile);
+    movie.rom = in.get<uint64_t>();
+    const uint32_t count = in.get<uint32_t>();
+    if(movie.hz == 0) throw std::runtime_error("movie cpu speed is 0");
+    movie.inputs.reserve(count);
+    while(movie.inputs.size() < count) {
+        const uint64_t run = in.varint();
+        Frame_input input;
+        input.keys = in.get<uint16_t>();
+        input.pressed = in.get<uint16_t>();
+        input.released = in.get<uint16_t>();
+        if(run == 0 || run > count - movie.inputs.size()) throw std::runtime_error("movie run overflows its frame count");
+        movie.inputs.insert(movie.inputs.end(), run, input);
+    }
+    if(!in.done()) throw std::runtime_error("trailing bytes after movie");
+    return movie;
+}
+
+void Movie::save(const char* path) const {
+    std::vector<uint8_t> out;
+    for(const char c : MOVIE_MAGIC) out.push_back(static_cast<uint8_t>(c));
+    put<uint16_t>(out, VERSION);
+    put<uint32_t>(out, rng_seed);
+    put<uint32_t>(out, hz);
+    put<uint8_t>(out, static_cast<uint8_t>(profile));
+    put<uint64_t>(out, rom);
+    put<uint32_t>(out, static_cast<uint32_t>(inputs.size()));
+    for(std::size_t i = 0; i < inputs.size();) {
+        std::size_t run = 1;
+        while(i + run < inputs.size() && inputs[i + run] == inputs[i]) ++run;
+        for(uint64_t v = run; ; v >>= 7) {
+            out.push_back(static_cast<uint8_t>((v & 0x7F) | (v >= 0x80 ? 0x80 : 0)));
+            if(v < 0x80) break;
+        }
+        put<uint16_t>(out, inputs[i].keys);
+        put<uint16_t>(out, inputs[i].pressed);
+        put<uint16_t>(out, inputs[i].released);
+        i += run;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+    if(!file) throw std::runtime_error(std::string("can't write ") + path);
+}
+
+void Movie::record(const Chip8System& chip8) {
+    inputs.push_back({pack(chip8.keys), pack(chip8.just_pressed), pack(chip8.just_released)});
+}
+
+bool Movie::apply(Chip8System& chip8, std::size_t frame) const {
+    const Frame_input input = frame < inputs.size() ? inputs[frame] : Frame_input{};
+    unpack(input.keys, chip8.keys);
+    unpack(input.pressed, chip8.just_pressed);
+    unpack(input.released, chip8.just_released);
+    return frame < inputs.size();
+}
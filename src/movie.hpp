@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "chip8_emulator.hpp"
+
+// input movie: the RNG seed , cpu speed , quirk profile and ROM checksum of a run plus the keypad state of every 60Hz frame.
+// replaying one against the same ROM reproduces the run exactly , with or without SDL.
+// on disk frames are run-length encoded , so long stretches with nothing pressed cost a few bytes.
+class Movie {
+    public:
+        static constexpr uint16_t VERSION = 3;
+
+        struct Frame_input {
+            uint16_t keys{}; // one bit per key , same for the edges
+            uint16_t pressed{};
+            uint16_t released{};
+            bool operator==(const Frame_input&) const = default;
+        };
+
+        Movie() = default;
+        Movie(uint32_t seed, uint32_t cpu_hz, Quirk_profile quirks, uint64_t rom_hash)
+            : rng_seed(seed), hz(cpu_hz), profile(quirks), rom(rom_hash) {}
+
+        static uint64_t hash_rom(const char* path); // FNV-1a of the ROM file , throws if it can't be read
+        static Movie load(const char* path);
+        void save(const char* path) const;
+
+        void record(const Chip8System& chip8); // appends the keypad state the frame about to run will see
+        bool apply(Chip8System& chip8, std::size_t frame) const; // false (and all keys up) past the end
+        void truncate(std::size_t count) {if(count < inputs.size()) inputs.resize(count);}
+
+        std::size_t frames() const {return inputs.size();}
+        uint32_t seed() const {return rng_seed;}
+        uint32_t cpu_hz() const {return hz;}
+        Quirk_profile quirks() const {return profile;} // replays have to run it , the ROM's guess may differ
+        uint64_t rom_hash() const {return rom;}
+
+    private:
+        uint32_t rng_seed{0};
+        uint32_t hz{700};
+        Quirk_profile profile{Quirk_profile::Hybrid};
+        uint64_t rom{0};
+        std::vector<Frame_input> inputs; // expanded in memory , 6 bytes a frame
+};
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "profiler.hpp"
+
+namespace {
+
+const char* const CLASS_NAMES[Profiler::OP_CLASSES] = {
+    "00E0", "00EE", "0NNN", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+    "8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE", "9XY0",
+    "ANNN", "BNNN", "CXNN", "DXYN", "EX9E", "EXA1",
+    "FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29", "FX33", "FX55", "FX65",
+    // SUPER-CHIP
+    "00CN", "00FB", "00FC", "00FD", "00FE", "00FF", "FX30", "FX75", "FX85",
+    // XO-CHIP
+    "00DN", "5XY2", "5XY3", "F000", "FN01", "F002", "FX3A",
+    "unknown",
+};
+constexpr std::size_t UNKNOWN = Profiler::OP_CLASSES - 1;
+
+std::string frame_name(uint16_t address) {
+    if(address == 0) return "main";
+    std::ostringstream name;
+    name << "sub_" << std::hex << std::uppercase << std::setw(3) << std::setfill('0') << address;
+    return name.str();
+}
+
+} // namespace
+
+Profiler::Profiler() : pc_hits(ADDRESS_SPACE), class_hits(OP_CLASSES) {
+    reset();
+}
+
+void Profiler::reset() {
+    std::fill(pc_hits.begin(), pc_hits.end(), 0);
+    std::fill(class_hits.begin(), class_hits.end(), 0);
+    nodes.assign(1, Node{0, NONE, NONE, NONE, 0, 0});
+    current = 0;
+    cycles = 0;
+}
+
+std::size_t Profiler::op_class(uint16_t opcode) {
+    const uint8_t n = opcode & 0xF;
+    const uint8_t nn = opcode & 0xFF;
+    switch(opcode >> 12) {
+        case 0x0:
+            if(opcode == 0x00E0) return 0;
+            if(opcode == 0x00EE) return 1;
+            if((opcode & 0xFFF0) == 0x00C0 && n) return 35;
+            if(opcode >= 0x00FB && opcode <= 0x00FF) return 36 + (opcode - 0x00FB);
+            if((opcode & 0xFFF0) == 0x00D0 && n) return 44;
+            return 2;
+        case 0x8:
+            if(n <= 0x7) return 10 + n;
+            return n == 0xE ? 18 : UNKNOWN;
+        case 0x9: return n == 0 ? 19 : UNKNOWN;
+        case 0x5:
+            if(n == 0) return 7;
+            if(n == 2) return 45;
+            return n == 3 ? 46 : UNKNOWN;
+        case 0xE:
+            if(nn == 0x9E) return 24;
+            return nn == 0xA1 ? 25 : UNKNOWN;
+        case 0xF:
+            switch(nn) {
+                case 0x07: return 26;
+                case 0x0A: return 27;
+                case 0x15: return 28;
+                case 0x18: return 29;
+                case 0x1E: return 30;
+                case 0x29: return 31;
+                case 0x33: return 32;
+                case 0x55: return 33;
+                case 0x65: return 34;
+                case 0x30: return 41;
+                case 0x75: return 42;
+                case 0x85: return 43;
+                case 0x00: return opcode == 0xF000 ? 47 : UNKNOWN;
+                case 0x01: return 48;
+                case 0x02: return opcode == 0xF002 ? 49 : UNKNOWN;
+                case 0x3A: return 50;
+                default: return UNKNOWN;
+            }
+        case 0xA: return 20;
+        case 0xB: return 21;
+        case 0xC: return 22;
+        case 0xD: return 23;
+        default: return 2 + (opcode >> 12); // 1NNN 2NNN 3XNN 4XNN 6XNN 7XNN
+    }
+}
+
+const char* Profiler::class_name(std::size_t op_class) {
+    return op_class < OP_CLASSES ? CLASS_NAMES[op_class] : CLASS_NAMES[UNKNOWN];
+}
+
+void Profiler::enter(uint16_t address) {
+    if(depth() >= MAX_DEPTH) return; // the VM is about to overflow its stack , keep charging the caller
+    uint32_t child = nodes[current].first_child;
+    while(child != NONE && nodes[child].address != address) child = nodes[child].next_sibling;
+    if(child == NONE) {
+        child = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(Node{address, current, NONE, nodes[current].first_child, 0, 0});
+        nodes[current].first_child = child;
+    }
+    ++nodes[child].calls;
+    current = child;
+}
+
+std::size_t Profiler::depth() const {
+    std::size_t d = 0;
+    for(uint32_t n = current; n != 0; n = nodes[n].parent) ++d;
+    return d;
+}
+
+std::vector<uint64_t> Profiler::inclusive() const {
+    // children are always appended after their parent , so one backwards pass sums every subtree
+    std::vector<uint64_t> total(nodes.size());
+    for(std::size_t i = nodes.size(); i-- > 0;) {
+        total[i] += nodes[i].self;
+        if(i != 0) total[nodes[i].parent] += total[i];
+    }
+    return total;
+}
+
+void Profiler::write_folded(std::ostream& out) const {
+    std::vector<uint16_t> path;
+    for(std::size_t i = 0; i < nodes.size(); ++i) {
+        if(nodes[i].self == 0) continue;
+        path.clear();
+        for(uint32_t n = static_cast<uint32_t>(i); n != NONE; n = nodes[n].parent) path.push_back(nodes[n].address);
+        for(std::size_t p = path.size(); p-- > 0;) out << frame_name(path[p]) << (p ? ";" : " ");
+        out << nodes[i].self << '\n';
+    }
+}
+
+void Profiler::write_report(std::ostream& out, std::size_t top) const {
+    const double scale = cycles ? 100.0 / static_cast<double>(cycles) : 0.0;
+    out << "cycles: " << cycles << "\n";
+
+    out << "opcode classes:\n";
+    std::vector<std::size_t> order(OP_CLASSES);
+    for(std::size_t i = 0; i < OP_CLASSES; ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {return class_hits[a] > class_hits[b];});
+    for(const std::size_t c : order) {
+        if(!class_hits[c]) break;
+        out << "  " << std::left << std::setw(8) << class_name(c) << std::right << std::setw(14) << class_hits[c]
+            << std::fixed << std::setprecision(2) << std::setw(8) << class_hits[c] * scale << "%\n";
+    }
+
+    out << "hottest pcs:\n";
+    std::vector<uint16_t> pcs(ADDRESS_SPACE);
+    for(std::size_t i = 0; i < ADDRESS_SPACE; ++i) pcs[i] = static_cast<uint16_t>(i);
+    std::stable_sort(pcs.begin(), pcs.end(), [&](uint16_t a, uint16_t b) {return pc_hits[a] > pc_hits[b];});
+    for(std::size_t i = 0; i < std::min(top, pcs.size()) && pc_hits[pcs[i]]; ++i) {
+        out << "  0x" << std::hex << std::uppercase << std::setw(3) << std::setfill('0') << pcs[i] << std::dec << std::setfill(' ')
+            << std::setw(14) << pc_hits[pcs[i]] << std::fixed << std::setprecision(2) << std::setw(8) << pc_hits[pcs[i]] * scale << "%\n";
+    }
+
+    // per subroutine , summed over every call path. inclusive skips nodes nested in the same
+    // subroutine (recursion) so a cycle is only counted once per address
+    struct Totals {uint64_t calls{0}; uint64_t self{0}; uint64_t inclusive{0};};
+    std::map<uint16_t, Totals> subs;
+    const std::vector<uint64_t> incl = inclusive();
+    for(std::size_t i = 0; i < nodes.size(); ++i) {
+        Totals& t = subs[nodes[i].address];
+        t.calls += nodes[i].calls;
+        t.self += nodes[i].self;
+        bool nested = false;
+        for(uint32_t n = nodes[i].parent; n != NONE && !nested; n = nodes[n].parent) nested = nodes[n].address == nodes[i].address && n != 0;
+        if(!nested) t.inclusive += incl[i];
+    }
+    std::vector<std::pair<uint16_t, Totals>> sorted(subs.begin(), subs.end());
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {return a.second.inclusive > b.second.inclusive;});
+    out << "subroutines:            calls          self     inclusive\n";
+    for(std::size_t i = 0; i < std::min(top, sorted.size()); ++i) {
+        const Totals& t = sorted[i].second;
+        out << "  " << std::left << std::setw(10) << frame_name(sorted[i].first) << std::right << std::setw(14) << t.calls
+            << std::setw(14) << t.self << std::setw(14) << t.inclusive << std::fixed << std::setprecision(2)
+            << std::setw(8) << t.inclusive * scale << "%\n";
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// execution profiler fed by Chip8System::cycle() when the build has CHIP8_PROFILE defined
+// (cmake -DCHIP8_PROFILE=ON). without it the hook and the member compile out entirely.
+// counts every instruction per opcode class and per pc , and follows 2NNN/00EE to keep a call tree
+// so cycles land on the subroutine (and call path) that spent them.
+class Profiler {
+    public:
+        static constexpr std::size_t ADDRESS_SPACE = 65536; // every pc a uint16_t holds , XO-CHIP code runs past 0xFFF
+        static constexpr std::size_t MAX_DEPTH = 16; // the VM stack , deeper calls would overflow it anyway
+        static constexpr std::size_t OP_CLASSES = 52;
+
+        Profiler();
+
+        // pc is where opcode was fetched from , call before it executes
+        void record(uint16_t pc, uint16_t opcode) {
+            ++pc_hits[pc];
+            ++class_hits[op_class(opcode)];
+            ++nodes[current].self;
+            ++cycles;
+            if((opcode & 0xF000) == 0x2000) enter(opcode & 0x0FFF);
+            else if(opcode == 0x00EE && current != 0) current = nodes[current].parent;
+        }
+        void reset();
+        void unwind() {current = 0;} // state was swapped under us (load_state) , the call path is unknown
+
+        static std::size_t op_class(uint16_t opcode);
+        static const char* class_name(std::size_t op_class);
+
+        uint64_t total() const {return cycles;}
+        uint64_t class_count(std::size_t op_class) const {return class_hits[op_class];}
+        const uint64_t* pc_counts() const {return pc_hits.data();} // ADDRESS_SPACE entries
+        std::size_t depth() const;
+
+        // flamegraph.pl / speedscope input: "main;sub_2A4;sub_31C <cycles>" per call path
+        void write_folded(std::ostream& out) const;
+        // opcode classes , hottest pcs and per subroutine self/inclusive cycles
+        void write_report(std::ostream& out, std::size_t top = 16) const;
+
+    private:
+        struct Node {
+            uint16_t address; // subroutine entry , 0 for the root (main program)
+            uint32_t parent;
+            uint32_t first_child;
+            uint32_t next_sibling;
+            uint64_t self;
+            uint64_t calls;
+        };
+        static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+        std::vector<uint64_t> pc_hits;
+        std::vector<uint64_t> class_hits;
+        std::vector<Node> nodes; // call tree , nodes[0] is main
+        uint32_t current{0};
+        uint64_t cycles{0};
+
+        void enter(uint16_t address);
+        std::vector<uint64_t> inclusive() const;
+};
@@ -0,0 +1,105 @@
+#include <bit>
+#include <cstring>
+#include <vector>
+
+#include "quirks.hpp"
+
+Quirk_flags quirk_flags(Quirk_profile profile) {
+    switch(profile) {
+        case Quirk_profile::Vip: return quirk_flags_of<Quirks_vip>();
+        case Quirk_profile::Chip48: return quirk_flags_of<Quirks_chip48>();
+        case Quirk_profile::Schip: return quirk_flags_of<Quirks_schip>();
+        case Quirk_profile::Xochip: return quirk_flags_of<Quirks_xochip>();
+        default: return quirk_flags_of<Quirks_hybrid>();
+    }
+}
+
+const char* quirk_name(Quirk_profile profile) {
+    switch(profile) {
+        case Quirk_profile::Vip: return "vip";
+        case Quirk_profile::Chip48: return "chip48";
+        case Quirk_profile::Schip: return "schip";
+        case Quirk_profile::Xochip: return "xochip";
+        default: return "hybrid";
+    }
+}
+
+bool parse_quirk_profile(const char* name, Quirk_profile& out) {
+    static constexpr Quirk_profile all[] = {Quirk_profile::Hybrid, Quirk_profile::Vip, Quirk_profile::Chip48,
+                                            Quirk_profile::Schip, Quirk_profile::Xochip};
+    for(Quirk_profile p : all) {
+        if(std::strcmp(name, quirk_name(p)) == 0) {
+            out = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+Quirk_profile detect_quirks(const uint8_t* rom, std::size_t size, uint16_t load_address) {
+    // only look at opcodes reachable from the entry point , sprite data is full of 00FF/00FE lookalikes.
+    // one bit per distinct extended opcode seen , a single hit is still too weak to go on
+    if(size > 0x1000u - load_address) return Quirk_profile::Xochip;
+    uint32_t schip = 0;
+    uint32_t xochip = 0;
+    std::vector<bool> seen(size);
+    std::vector<std::size_t> work{0};
+    auto follow = [&](uint16_t address) {
+        if(address >= load_address) work.push_back(address - load_address);
+    };
+    while(!work.empty()) {
+        const std::size_t at = work.back();
+        work.pop_back();
+        if(at + 1 >= size || seen[at]) continue;
+        seen[at] = true;
+        const uint16_t op = static_cast<uint16_t>(rom[at] << 8 | rom[at + 1]);
+        const uint16_t pc = static_cast<uint16_t>(load_address + at);
+        const uint8_t nn = op & 0xFFu;
+        std::size_t length = 2;
+        bool falls_through = true;
+        switch(op >> 12) {
+            case 0x0:
+                if(op == 0x00EE) falls_through = false;
+                else if(op == 0x00FD) falls_through = false; // exit
+                else if(op == 0x00FF) schip |= 1u << 0; // high resolution
+                else if(op == 0x00FE) schip |= 1u << 1; // low resolution
+                else if(op == 0x00FB) schip |= 1u << 2; // scroll right
+                else if(op == 0x00FC) schip |= 1u << 3; // scroll left
+                else if((op & 0xFFF0u) == 0x00C0 && (op & 0xFu)) schip |= 1u << 4; // scroll down
+                else if((op & 0xFFF0u) == 0x00D0 && (op & 0xFu)) xochip |= 1u << 0; // scroll up
+                break;
+            case 0x1:
+                follow(op & 0x0FFFu);
+                falls_through = false;
+                break;
+            case 0x2:
+                follow(op & 0x0FFFu);
+                break;
+            case 0x3: case 0x4: case 0x9: case 0xE:
+                follow(pc + 4); // skips
+                break;
+            case 0x5:
+                if((op & 0xFu) == 0x2 || (op & 0xFu) == 0x3) xochip |= 1u << 1; // save/load a register range
+                else follow(pc + 4);
+                break;
+            case 0xB:
+                falls_through = false; // computed jump , can't follow
+                break;
+            case 0xF:
+                if(op == 0xF000) {
+                    xochip |= 1u << 2; // I = next 16 bits
+                    length = 4;
+                }
+                else if(op == 0xF002) xochip |= 1u << 3; // audio pattern
+                else if(nn == 0x01) xochip |= 1u << 4; // bitplane select
+                else if(nn == 0x3A) xochip |= 1u << 5; // pitch
+                else if(nn == 0x30) schip |= 1u << 5; // big font
+                else if(nn == 0x75 || nn == 0x85) schip |= 1u << 6; // flag registers
+                break;
+        }
+        if(falls_through) work.push_back(at + length);
+    }
+    if(std::popcount(xochip) >= 2) return Quirk_profile::Xochip;
+    if(std::popcount(schip) >= 2) return Quirk_profile::Schip;
+    return Quirk_profile::Hybrid;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// behaviours that differ between CHIP-8 implementations. each profile is a compile-time policy ,
+// Chip8System instantiates its quirk dependent handlers once per profile and swaps the dispatch tables over ,
+// so no handler tests a quirk flag at run time. the SUPER-CHIP and XO-CHIP profiles also switch on the instructions
+// those interpreters added
+enum class Quirk_profile : uint8_t {
+    Hybrid, // what this core always ran: VIP logic flags and jump , in place shifts , I left alone , wrapping sprites
+    Vip,    // COSMAC VIP interpreter
+    Chip48, // HP-48 CHIP-48
+    Schip,  // SUPER-CHIP 1.1
+    Xochip  // XO-CHIP (Octo)
+};
+
+// what FX55/FX65 leave in I
+enum class Index_increment : uint8_t {None, By_x, By_x_plus_1};
+
+struct Quirks_hybrid {
+    static constexpr bool vf_reset = true; // 8XY1/8XY2/8XY3 clear VF
+    static constexpr bool shift_vy = false; // 8XY6/8XYE shift Vy into Vx instead of shifting Vx in place
+    static constexpr Index_increment index_increment = Index_increment::None;
+    static constexpr bool jump_vx = false; // BXNN jumps to XNN + VX instead of NNN + V0
+    static constexpr bool clip_sprites = false; // sprites are cut at the screen edges instead of wrapping
+    static constexpr bool display_wait = false; // DXYN holds the cpu until the next 60Hz tick (vblank)
+    static constexpr bool schip_ops = false; // 128x64 hires , scrolling , 16x16 sprites , big font , flag registers
+    static constexpr bool xochip_ops = false; // 64KB memory , bitplanes , F000 NNNN , register ranges , skips over F000
+};
+
+struct Quirks_vip {
+    static constexpr bool vf_reset = true;
+    static constexpr bool shift_vy = true;
+    static constexpr Index_increment index_increment = Index_increment::By_x_plus_1;
+    static constexpr bool jump_vx = false;
+    static constexpr bool clip_sprites = true;
+    static constexpr bool display_wait = true;
+    static constexpr bool schip_ops = false;
+    static constexpr bool xochip_ops = false;
+};
+
+struct Quirks_chip48 {
+    static constexpr bool vf_reset = false;
+    static constexpr bool shift_vy = false;
+    static constexpr Index_increment index_increment = Index_increment::By_x;
+    static constexpr bool jump_vx = true;
+    static constexpr bool clip_sprites = true;
+    static constexpr bool display_wait = false;
+    static constexpr bool schip_ops = false;
+    static constexpr bool xochip_ops = false;
+};
+
+struct Quirks_schip {
+    static constexpr bool vf_reset = false;
+    static constexpr bool shift_vy = false;
+    static constexpr Index_increment index_increment = Index_increment::None;
+    static constexpr bool jump_vx = true;
+    static constexpr bool clip_sprites = true;
+    static constexpr bool display_wait = false;
+    static constexpr bool schip_ops = true;
+    static constexpr bool xochip_ops = false;
+};
+
+struct Quirks_xochip {
+    static constexpr bool vf_reset = false;
+    static constexpr bool shift_vy = true;
+    static constexpr Index_increment index_increment = Index_increment::By_x_plus_1;
+    static constexpr bool jump_vx = false;
+    static constexpr bool clip_sprites = false;
+    static constexpr bool display_wait = false;
+    static constexpr bool schip_ops = true;
+    static constexpr bool xochip_ops = true;
+};
+
+// the same flags as values , for the code generators that can't take a template parameter (jit)
+struct Quirk_flags {
+    bool vf_reset{};
+    bool shift_vy{};
+    Index_increment index_increment{};
+    bool jump_vx{};
+    bool clip_sprites{};
+    bool display_wait{};
+    bool schip_ops{};
+    bool xochip_ops{};
+};
+
+template<class Q> constexpr Quirk_flags quirk_flags_of() {
+    return {Q::vf_reset, Q::shift_vy, Q::index_increment, Q::jump_vx, Q::clip_sprites, Q::display_wait,
+            Q::schip_ops, Q::xochip_ops};
+}
+
+Quirk_flags quirk_flags(Quirk_profile profile);
+const char* quirk_name(Quirk_profile profile);
+bool parse_quirk_profile(const char* name, Quirk_profile& out); // hybrid , vip , chip48 , schip or xochip
+
+// runtime factory: guesses the profile a ROM was written for from the opcodes only later interpreters have
+// (00FF/00FE/00Cn/FX75... for SUPER-CHIP , F000 NNNN/5XY2/FN01... for XO-CHIP) , walking the code reachable
+// from the entry point. plain CHIP-8 ROMs get Hybrid , the profile the bundled ROMs were tuned against.
+// anything too big for 4KB can only be XO-CHIP
+Quirk_profile detect_quirks(const uint8_t* rom, std::size_t size, uint16_t load_address = 0x200);
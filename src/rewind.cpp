@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "rewind.hpp"
+
+namespace {
+
+void put_varint(std::vector<uint8_t>& out, std::size_t value) {
+    while(value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+std::size_t get_varint(const uint8_t*& in) {
+    std::size_t value = 0;
+    for(unsigned shift = 0;; shift += 7) {
+        const uint8_t b = *in++;
+        value |= static_cast<std::size_t>(b & 0x7F) << shift;
+        if(!(b & 0x80)) return value;
+    }
+}
+
+// (zero run , literal length , literal bytes) triples over a XOR of two states , or over a raw keyframe
+void encode_xor(const std::vector<uint8_t>& now, const std::vector<uint8_t>* before, std::vector<uint8_t>& out) {
+    out.clear();
+    const std::size_t size = now.size();
+    auto byte = [&](std::size_t i) -> uint8_t {return before ? now[i] ^ (*before)[i] : now[i];};
+    std::size_t i = 0;
+    while(i < size) {
+        const std::size_t zero_start = i;
+        while(i < size && byte(i) == 0) ++i;
+        const std::size_t literal_start = i;
+        while(i < size && byte(i) != 0) ++i;
+        put_varint(out, literal_start - zero_start);
+        put_varint(out, i - literal_start);
+        for(std::size_t j = literal_start; j < i; ++j) out.push_back(byte(j));
+    }
+}
+
+} // namespace
+
+Rewind_buffer::Rewind_buffer(std::size_t capacity) : ring(capacity) {}
+
+void Rewind_buffer::clear() {
+    entries.clear();
+    head = 0;
+    used = 0;
+    since_keyframe = 0;
+    previous.clear();
+}
+
+void Rewind_buffer::record(const Chip8System& chip8) {
+    chip8.write_state(current);
+    bool keyframe = entries.empty() || since_keyframe + 1 >= KEYFRAME_INTERVAL || previous.size() != current.size();
+    encode_xor(current, keyframe ? nullptr : &previous, packed);
+    make_room(packed.size());
+    if(entries.empty() && !keyframe) {
+        // eviction took the keyframe this delta chains from , store the frame whole instead
+        keyframe = true;
+        encode_xor(current, nullptr, packed);
+        make_room(packed.size());
+    }
+
+    std::copy(packed.begin(), packed.end(), ring.begin() + static_cast<std::ptrdiff_t>(head));
+    entries.push_back({head, packed.size(), current.size(), keyframe});
+    head += packed.size();
+    used += packed.size();
+    since_keyframe = keyframe ? 0 : since_keyframe + 1;
+    previous.swap(current);
+}
+
+void Rewind_buffer::make_room(std::size_t size) {
+    if(size > ring.size()) throw std::runtime_error("rewind buffer smaller than one frame");
+    if(head + size > ring.size()) head = 0; // entries never straddle the end of the ring
+
+    // drop every entry the new one lands on , plus the deltas that chained from a dropped keyframe
+    auto overlaps = [&](const Entry& e) {return e.offset < head + size && head < e.offset + e.size;};
+    while(!entries.empty() && overlaps(entries.front())) {
+        do {
+            used -= entries.front().size;
+            entries.pop_front();
+        } while(!entries.empty() && !entries.front().keyframe);
+    }
+}
+
+void Rewind_buffer::decode_into(const Entry& entry, std::vector<uint8_t>& state) const {
+    const uint8_t* in = ring.data() + entry.offset;
+    const uint8_t* end = in + entry.size;
+    std::size_t pos = 0;
+    while(in < end) {
+        pos += get_varint(in);
+        const std::size_t literal = get_varint(in);
+        for(std::size_t j = 0; j < literal; ++j) state[pos++] ^= *in++;
+    }
+}
+
+bool Rewind_buffer::step_back(Chip8System& chip8) {
+    if(entries.size() < 2) return false;
+
+    // the newest entry is the frame on screen now , rebuild the one before it from its keyframe
+    used -= entries.back().size;
+    head = entries.back().offset;
+    entries.pop_back();
+    std::size_t key = entries.size() - 1;
+    while(!entries[key].keyframe) --key;
+    current.assign(entries[key].state_size, 0); // the whole group has the keyframe's size
+    for(std::size_t i = key; i < entries.size(); ++i) decode_into(entries[i], current);
+    since_keyframe = entries.size() - 1 - key;
+    previous.swap(current);
+
+    // the keypad belongs to the player , not to the history
+    uint8_t held[Chip8System::INPUT_SIZE];
+    std::copy(std::begin(chip8.keys), std::end(chip8.keys), held);
+    chip8.load_state(previous);
+    std::copy(std::begin(held), std::end(held), chip8.keys);
+    std::fill(std::begin(chip8.just_pressed), std::end(chip8.just_pressed), 0);
+    std::fill(std::begin(chip8.just_released), std::end(chip8.just_released), 0);
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "chip8_emulator.hpp"
+
+// rewind history: one entry per 60Hz frame in a fixed-size byte ring. every entry is the full save state
+// XORed against the previous frame and run-length encoded (mostly zero runs) , with a keyframe every
+// KEYFRAME_INTERVAL frames so stepping back never replays more than that many deltas.
+// when the ring fills the oldest keyframe group is dropped.
+class Rewind_buffer {
+    public:
+        static constexpr std::size_t DEFAULT_CAPACITY = 4u << 20; // 4MB , typical ROMs cost 50-100 bytes a frame so this holds 10+ minutes
+        static constexpr std::size_t KEYFRAME_INTERVAL = 60;
+        static constexpr std::size_t FRAME_HZ = 60;
+
+        explicit Rewind_buffer(std::size_t capacity = DEFAULT_CAPACITY);
+
+        void record(const Chip8System& chip8); // call once per frame , after the timer tick
+        bool step_back(Chip8System& chip8); // restores the previous recorded frame , false once history runs out
+        void clear();
+
+        std::size_t frames() const {return entries.size();}
+        double seconds() const {return static_cast<double>(entries.size()) / FRAME_HZ;}
+        std::size_t bytes_used() const {return used;}
+
+    private:
+        struct Entry {
+            std::size_t offset;
+            std::size_t size;
+            std::size_t state_size; // write_state() bytes , it changes with the memory size so a change starts a keyframe
+            bool keyframe;
+        };
+
+        std::vector<uint8_t> ring;
+        std::size_t head{0}; // next write offset
+        std::size_t used{0};
+        std::deque<Entry> entries; // oldest first , the front is always a keyframe
+        std::size_t since_keyframe{0};
+        std::vector<uint8_t> previous; // full state of the newest entry
+        std::vector<uint8_t> current; // scratch
+        std::vector<uint8_t> packed; // scratch
+
+        void make_room(std::size_t size); // wraps head and evicts the oldest entries in the way
+        void decode_into(const Entry& entry, std::vector<uint8_t>& state) const; // XORs the entry onto state
+};
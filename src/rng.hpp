@@ -0,0 +1,47 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+
+// PCG32 (XSH RR) on one 64-bit state with a fixed stream , 8 bytes per machine instead of mt19937's 5KB.
+// advance() jumps over n draws in O(log n) , so save states can keep storing seed + draw count
+class Pcg32 {
+    public:
+        explicit Pcg32(uint32_t value = 0) {seed(value);}
+
+        void seed(uint32_t value) {
+            state = 0;
+            next();
+            state += value;
+            next();
+        }
+
+        uint32_t next() {
+            const uint64_t old = state;
+            state = old * MULTIPLIER + INCREMENT;
+            const uint32_t xorshifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+            return std::rotr(xorshifted, static_cast<int>(old >> 59u));
+        }
+
+        uint8_t next_byte() {return static_cast<uint8_t>(next() >> 24u);} // CXNN , the top bits are the best ones
+
+        void advance(uint64_t draws) {
+            // square-and-multiply on the LCG step
+            uint64_t mult = 1, plus = 0;
+            uint64_t step_mult = MULTIPLIER, step_plus = INCREMENT;
+            for(; draws; draws >>= 1) {
+                if(draws & 1u) {
+                    mult *= step_mult;
+                    plus = plus * step_mult + step_plus;
+                }
+                step_plus *= step_mult + 1;
+                step_mult *= step_mult;
+            }
+            state = mult * state + plus;
+        }
+
+    private:
+        static constexpr uint64_t MULTIPLIER = 6364136223846793005ull;
+        static constexpr uint64_t INCREMENT = 1442695040888963407ull;
+        uint64_t state{0};
+};
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "rom_cache.hpp"
+
+namespace {
+
+constexpr uint8_t fontset[Chip8System::FONTS_SIZE] =
+	{
+		0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+		0x20, 0x60, 0x20, 0x20, 0x70, // 1
+		0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+		0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+		0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+		0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+		0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+		0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+		0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+		0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+		0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+		0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+		0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+		0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+		0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+		0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+	};
+
+// SUPER-CHIP 8x10 digits , FX30 points I at these
+constexpr uint8_t big_fontset[Chip8System::BIG_FONTS_SIZE] =
+	{
+		0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+		0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+		0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+		0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+		0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+		0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+		0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+		0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+		0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+		0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+		0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+		0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+	};
+
+constexpr uint8_t zero_page[Chip8System::MEMORY_PAGE_SIZE]{};
+
+struct Cache_entry {
+    std::uintmax_t size{};
+    std::filesystem::file_time_type modified{};
+    std::shared_ptr<const Rom_image> image;
+};
+
+std::mutex cache_lock;
+std::unordered_map<std::string, Cache_entry> cache; // by path as given
+
+} // namespace
+
+const uint8_t* Rom_image::page(std::size_t index) const {
+    const std::size_t address = index * Chip8System::MEMORY_PAGE_SIZE;
+    return address < memory.size() ? memory.data() + address : zero_page;
+}
+
+std::shared_ptr<const Rom_image> Rom_cache::build(const uint8_t* data, std::size_t size) {
+    if(size > (Chip8System::XO_MEMORY_SIZE - Chip8System::START_ADDRESS)) throw std::runtime_error("ROM too large to run!");
+    auto image = std::make_shared<Rom_image>();
+    // only XO-CHIP has room past 4KB
+    const bool fits = size <= Chip8System::MEMORY_SIZE - Chip8System::START_ADDRESS;
+    image->memory.resize(fits ? Chip8System::MEMORY_SIZE : Chip8System::XO_MEMORY_SIZE);
+    std::copy(std::begin(fontset), std::end(fontset), &image->memory[Chip8System::FONTS_START_ADDRESS]);
+    std::copy(std::begin(big_fontset), std::end(big_fontset), &image->memory[Chip8System::BIG_FONTS_START_ADDRESS]);
+    std::copy(data, data + size, &image->memory[Chip8System::START_ADDRESS]);
+    image->rom_size = size;
+    image->detected = detect_quirks(data, size);
+    return image;
+}
+
+std::shared_ptr<const Rom_image> Rom_cache::load(const char* path) {
+    std::error_code error;
+    const std::uintmax_t size = std::filesystem::file_size(path, error);
+    if(error) throw std::runtime_error("ROM load failed!");
+    const std::filesystem::file_time_type modified = std::filesystem::last_write_time(path, error);
+
+    std::lock_guard<std::mutex> lock(cache_lock);
+    Cache_entry& entry = cache[path];
+    if(entry.image && entry.size == size && entry.modified == modified) return entry.image;
+
+    if(size > (Chip8System::XO_MEMORY_SIZE - Chip8System::START_ADDRESS)) throw std::runtime_error("ROM too large to run!");
+    std::ifstream ROMContent(path, std::ios::binary);
+    if(!ROMContent) throw std::runtime_error("ROM load failed!");
+    std::vector<uint8_t> data(size);
+    ROMContent.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(size));
+    if(!ROMContent) throw std::runtime_error("ROM load failed!");
+    entry.image = build(data.data(), data.size());
+    entry.size = size;
+    entry.modified = modified;
+    return entry.image;
+}
+
+std::shared_ptr<const Rom_image> Rom_cache::blank() {
+    static const std::shared_ptr<const Rom_image> image = build(nullptr, 0);
+    return image;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "chip8_emulator.hpp"
+
+// a ROM laid out as the memory it boots into: fonts , big font and the program at START_ADDRESS , 4KB or (when
+// the program only fits XO-CHIP) 64KB. read and checked once , then shared read-only by every Chip8System
+// running it. machines map its MEMORY_PAGE_SIZE pages and copy one only when they write to it
+struct Rom_image {
+    std::vector<uint8_t> memory;
+    std::size_t rom_size{0};
+    Quirk_profile detected{Quirk_profile::Hybrid}; // detect_quirks on the program , run once here
+    const uint8_t* page(std::size_t index) const; // zeros past the end of memory , for XO-CHIP on a 4KB image
+};
+
+// process-wide ROM images , safe to use from several threads. a path is read again only when the file's
+// size or modification time changed
+class Rom_cache {
+    public:
+        static std::shared_ptr<const Rom_image> load(const char* path);
+        static std::shared_ptr<const Rom_image> build(const uint8_t* data, std::size_t size); // uncached (embedded ROMs)
+        static std::shared_ptr<const Rom_image> blank(); // fonts only , what a machine boots before load_ROM
+};
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "chip8_emulator.hpp"
+
+// save state layout , all values little endian:
+//   "C8ST" , u16 version , u8 kind (0 full , 1 delta) , u8 wait flags (1 = awaiting_input , 2 = awaiting_release ,
+//   4 = vblank_wait)
+//   delta only: u64 FNV-1a of the full state it applies to
+//   u8 quirk profile , u8 video (1 = hires , plane mask << 1)
+//   u16 pc , u16 I , u16 opcode , u8 sp , u8 dt , u8 st , u8 wait_reg , u8 down_key , u8 V[16] , u8 flag registers[16]
+//   u16 stack[16] , u16 keys , u16 just_pressed , u16 just_released (one bit per key) , u32 rng seed , u64 rng draws
+//   display words: the lores planes as u64 rows , then the hires planes for profiles with SUPER-CHIP ops
+//   full:  display words , u8 memory[4096 , or 65536 for XO-CHIP]
+//   delta: u64 mask + changed words per 64 display words , u64 page mask + changed memory pages (1/64th of memory each)
+
+namespace {
+
+constexpr char STATE_MAGIC[4] = {'C', '8', 'S', 'T'};
+constexpr uint8_t KIND_FULL = 0;
+constexpr uint8_t KIND_DELTA = 1;
+constexpr std::size_t PAGES = Chip8System::STATE_PAGES;
+static_assert(PAGES == 64, "page mask is a single u64");
+constexpr std::size_t LORES_WORDS = sizeof(Chip8System::Lores_screen::rows) / sizeof(uint64_t);
+constexpr std::size_t HIRES_WORDS = sizeof(Chip8System::Hires_screen::rows) / sizeof(uint64_t);
+static_assert(LORES_WORDS % 64 == 0 && HIRES_WORDS % 64 == 0, "display words go in groups of 64 per delta mask");
+
+// what a profile's state holds , both sides of a save/load have to agree on it
+std::size_t display_words(Quirk_profile profile) {return LORES_WORDS + (quirk_flags(profile).schip_ops ? HIRES_WORDS : 0);}
+std::size_t memory_bytes(Quirk_profile profile) {
+    return quirk_flags(profile).xochip_ops ? Chip8System::XO_MEMORY_SIZE : Chip8System::MEMORY_SIZE;
+}
+
+uint64_t checksum(const std::vector<uint8_t>& data) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for(const uint8_t b : data) {
+        hash ^= b;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+class Writer {
+    public:
+        explicit Writer(std::vector<uint8_t>& out) : out(out) {}
+        template<class T> void put(T value) {
+            for(std::size_t i = 0; i < sizeof(T); ++i) out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i)));
+        }
+        void bytes(const uint8_t* data, std::size_t size) {out.insert(out.end(), data, data + size);}
+
+    private:
+        std::vector<uint8_t>& out;
+};
+
+class Reader {
+    public:
+        explicit Reader(const std::vector<uint8_t>& in) : in(in) {}
+        template<class T> T get() {
+            need(sizeof(T));
+            uint64_t value = 0;
+            for(std::size_t i = 0; i < sizeof(T); ++i) value |= static_cast<uint64_t>(in[pos++]) << (8 * i);
+            return static_cast<T>(value);
+        }
+        void bytes(uint8_t* data, std::size_t size) {
+            need(size);
+            std::copy(in.begin() + pos, in.begin() + pos + size, data);
+            pos += size;
+        }
+        bool done() const {return pos == in.size();}
+
+    private:
+        const std::vector<uint8_t>& in;
+        std::size_t pos{0};
+        void need(std::size_t size) const {
+            if(in.size() - pos < size) throw std::runtime_error("save state truncated");
+        }
+};
+
+uint16_t key_mask(const uint8_t* keys) {
+    uint16_t mask = 0;
+    for(std::size_t k = 0; k < Chip8System::INPUT_SIZE; ++k) mask |= static_cast<uint16_t>(keys[k] != 0) << k;
+    return mask;
+}
+
+void unpack_keys(uint16_t mask, uint8_t* keys) {
+    for(std::size_t k = 0; k < Chip8System::INPUT_SIZE; ++k) keys[k] = (mask >> k) & 1u;
+}
+
+// everything load_state decodes , filled in completely before the machine is touched
+struct Decoded {
+    uint8_t kind{};
+    uint8_t wait_flags{};
+    uint64_t base_sum{};
+    uint16_t pc{}, index{}, opcode{};
+    uint8_t sp{}, dt{}, st{}, wait_reg{}, down_key{};
+    uint8_t profile{}, video{};
+    uint8_t registers[Chip8System::REGISTERS]{};
+    uint8_t flag_registers[Chip8System::FLAG_REGISTERS]{};
+    uint16_t stack[Chip8System::STACK_SIZE]{};
+    uint16_t keys{}, pressed{}, released{};
+    uint32_t rng_seed{};
+    uint64_t rng_draws{};
+    std::vector<uint64_t> display; // display_words(profile)
+    std::vector<uint8_t> memory; // memory_bytes(profile)
+    uint64_t page_mask{};
+};
+
+// reads the header and register block , then the full or delta payload on top of whatever display/memory d already holds
+void decode_state(const std::vector<uint8_t>& data, Decoded& d) {
+    Reader in(data);
+    char magic[4];
+    for(char& c : magic) c = static_cast<char>(in.get<uint8_t>());
+    if(std::memcmp(magic, STATE_MAGIC, sizeof(magic)) != 0) throw std::runtime_error("not a chip8 save state");
+    const uint16_t version = in.get<uint16_t>();
+    if(version != Chip8System::STATE_VERSION) throw std::runtime_error("unsupported save state version " + std::to_string(version));
+    d.kind = in.get<uint8_t>();
+    if(d.kind != KIND_FULL && d.kind != KIND_DELTA) throw std::runtime_error("unknown save state kind");
+    d.wait_flags = in.get<uint8_t>();
+    if(d.kind == KIND_DELTA) d.base_sum = in.get<uint64_t>();
+    const uint8_t profile = in.get<uint8_t>();
+    if(profile > static_cast<uint8_t>(Quirk_profile::Xochip)) throw std::runtime_error("unknown quirk profile in save state");
+    if(d.kind == KIND_DELTA && profile != d.profile) throw std::runtime_error("delta and base were saved under different quirk profiles");
+    d.profile = profile;
+    d.video = in.get<uint8_t>();
+    d.display.resize(display_words(static_cast<Quirk_profile>(profile)));
+    d.memory.resize(memory_bytes(static_cast<Quirk_profile>(profile)));
+
+    d.pc = in.get<uint16_t>();
+    d.index = in.get<uint16_t>();
+    d.opcode = in.get<uint16_t>();
+    d.sp = in.get<uint8_t>();
+    d.dt = in.get<uint8_t>();
+    d.st = in.get<uint8_t>();
+    d.wait_reg = in.get<uint8_t>();
+    d.down_key = in.get<uint8_t>();
+    in.bytes(d.registers, sizeof(d.registers));
+    in.bytes(d.flag_registers, sizeof(d.flag_registers));
+    for(uint16_t& slot : d.stack) slot = in.get<uint16_t>();
+    d.keys = in.get<uint16_t>();
+    d.pressed = in.get<uint16_t>();
+    d.released = in.get<uint16_t>();
+    d.rng_seed = in.get<uint32_t>();
+    d.rng_draws = in.get<uint64_t>();
+    if(d.sp > Chip8System::STACK_SIZE || d.wait_reg >= Chip8System::REGISTERS || d.down_key >= Chip8System::INPUT_SIZE) {
+        throw std::runtime_error("save state registers out of range");
+    }
+
+    if((d.video & 1u) && !quirk_flags(static_cast<Quirk_profile>(profile)).schip_ops) throw std::runtime_error("save state hires without SUPER-CHIP");
+
+    if(d.kind == KIND_FULL) {
+        for(uint64_t& word : d.display) word = in.get<uint64_t>();
+        in.bytes(d.memory.data(), d.memory.size());
+    } else {
+        for(std::size_t group = 0; group < d.display.size(); group += 64) {
+            const uint64_t mask = in.get<uint64_t>();
+            for(std::size_t i = 0; i < 64; ++i) {
+                if((mask >> i) & 1u) d.display[group + i] = in.get<uint64_t>();
+            }
+        }
+        const std::size_t page_size = d.memory.size() / PAGES;
+        d.page_mask = in.get<uint64_t>();
+        for(std::size_t page = 0; page < PAGES; ++page) {
+            if((d.page_mask >> page) & 1u) in.bytes(&d.memory[page * page_size], page_size);
+        }
+    }
+    if(!in.done()) throw std::runtime_error("trailing bytes after save state");
+}
+
+} // namespace
+
+void Chip8System::copy_display_words(uint64_t* out) const {
+    std::memcpy(out, lores_display.rows, sizeof(lores_display.rows));
+    if(quirk_flags(quirks).schip_ops) std::memcpy(out + LORES_WORDS, hires_buffer->rows, sizeof(hires_buffer->rows));
+}
+
+std::vector<uint8_t> Chip8System::save_state() {
+    std::vector<uint8_t> out;
+    write_state(out);
+
+    // this save is now the base later deltas are taken against
+    dirty_pages = 0;
+    state_base = checksum(out);
+    return out;
+}
+
+void Chip8System::write_state(std::vector<uint8_t>& out) const {
+    out.clear();
+    out.reserve(4 + 4 + 2 + 112 + display_words(quirks) * sizeof(uint64_t) + memory_size);
+    Writer w(out);
+    for(const char c : STATE_MAGIC) w.put<uint8_t>(c);
+    w.put<uint16_t>(STATE_VERSION);
+    w.put<uint8_t>(KIND_FULL);
+    w.put<uint8_t>(awaiting_input | awaiting_release << 1 | vblank_wait << 2);
+    w.put<uint8_t>(static_cast<uint8_t>(quirks));
+    w.put<uint8_t>(hires_mode | plane_mask << 1);
+    w.put<uint16_t>(program_counter);
+    w.put<uint16_t>(index_reg);
+    w.put<uint16_t>(opcode);
+    w.put<uint8_t>(stack_pointer);
+    w.put<uint8_t>(delay_timer);
+    w.put<uint8_t>(sound_timer);
+    w.put<uint8_t>(wait_reg);
+    w.put<uint8_t>(down_key);
+    w.bytes(registers, REGISTERS);
+    w.bytes(flag_registers, FLAG_REGISTERS);
+    for(const uint16_t slot : stack) w.put<uint16_t>(slot);
+    w.put<uint16_t>(key_mask(keys));
+    w.put<uint16_t>(key_mask(just_pressed));
+    w.put<uint16_t>(key_mask(just_released));
+    w.put<uint32_t>(rng_seed);
+    w.put<uint64_t>(rng_draws);
+    std::vector<uint64_t> words(display_words(quirks));
+    copy_display_words(words.data());
+    for(const uint64_t word : words) w.put<uint64_t>(word);
+    for(std::size_t a = 0; a < memory_size; a += MEMORY_PAGE_SIZE) w.bytes(memory_at(a), MEMORY_PAGE_SIZE);
+}
+
+std::vector<uint8_t> Chip8System::save_delta(const std::vector<uint8_t>& base) const {
+    // dirty_pages only means something relative to the last full save (or load) , so that's the only valid base
+    const uint64_t base_sum = checksum(base);
+    if(base_sum != state_base) throw std::runtime_error("delta base is not this machine's last full save state");
+    Decoded old;
+    decode_state(base, old);
+
+    std::vector<uint8_t> out;
+    Writer w(out);
+    for(const char c : STATE_MAGIC) w.put<uint8_t>(c);
+    w.put<uint16_t>(STATE_VERSION);
+    w.put<uint8_t>(KIND_DELTA);
+    w.put<uint8_t>(awaiting_input | awaiting_release << 1 | vblank_wait << 2);
+    w.put<uint64_t>(base_sum);
+    w.put<uint8_t>(static_cast<uint8_t>(quirks));
+    w.put<uint8_t>(hires_mode | plane_mask << 1);
+    w.put<uint16_t>(program_counter);
+    w.put<uint16_t>(index_reg);
+    w.put<uint16_t>(opcode);
+    w.put<uint8_t>(stack_pointer);
+    w.put<uint8_t>(delay_timer);
+    w.put<uint8_t>(sound_timer);
+    w.put<uint8_t>(wait_reg);
+    w.put<uint8_t>(down_key);
+    w.bytes(registers, REGISTERS);
+    w.bytes(flag_registers, FLAG_REGISTERS);
+    for(const uint16_t slot : stack) w.put<uint16_t>(slot);
+    w.put<uint16_t>(key_mask(keys));
+    w.put<uint16_t>(key_mask(just_pressed));
+    w.put<uint16_t>(key_mask(just_released));
+    w.put<uint32_t>(rng_seed);
+    w.put<uint64_t>(rng_draws);
+
+    // display words are cheap to compare , memory pages come straight from the dirty mask
+    std::vector<uint64_t> words(display_words(quirks));
+    copy_display_words(words.data());
+    for(std::size_t group = 0; group < words.size(); group += 64) {
+        uint64_t mask = 0;
+        for(std::size_t i = 0; i < 64; ++i) mask |= static_cast<uint64_t>(words[group + i] != old.display[group + i]) << i;
+        w.put<uint64_t>(mask);
+        for(std::size_t i = 0; i < 64; ++i) {
+            if((mask >> i) & 1u) w.put<uint64_t>(words[group + i]);
+        }
+    }
+    const std::size_t page_size = state_page_size();
+    w.put<uint64_t>(dirty_pages);
+    for(std::size_t page = 0; page < PAGES; ++page) {
+        if(!((dirty_pages >> page) & 1u)) continue;
+        // state pages are 64 bytes (4 per memory page) with 4KB , 1KB (4 memory pages) with XO-CHIP's 64KB
+        const std::size_t chunk = std::min(page_size, MEMORY_PAGE_SIZE);
+        for(std::size_t a = page * page_size; a < (page + 1) * page_size; a += chunk) w.bytes(memory_at(a), chunk);
+    }
+    return out;
+}
+
+void Chip8System::load_state(const std::vector<uint8_t>& state, const std::vector<uint8_t>* base) {
+    auto d = std::make_unique<Decoded>();
+    uint64_t base_sum = checksum(state);
+    if(state.size() >= 7 && state[6] == KIND_DELTA) {
+        if(!base) throw std::runtime_error("delta save state needs its base state");
+        decode_state(*base, *d);
+        if(d->kind != KIND_FULL) throw std::runtime_error("delta base must be a full save state");
+        base_sum = checksum(*base);
+    }
+    decode_state(state, *d);
+    if(d->kind == KIND_DELTA && d->base_sum != base_sum) throw std::runtime_error("delta was saved against a different base state");
+    if(static_cast<Quirk_profile>(d->profile) != quirks) set_quirks(static_cast<Quirk_profile>(d->profile));
+
+    program_counter = d->pc;
+    index_reg = d->index;
+    opcode = d->opcode;
+    stack_pointer = d->sp;
+    delay_timer = d->dt;
+    sound_timer = d->st;
+    wait_reg = d->wait_reg;
+    down_key = d->down_key;
+    awaiting_input = d->wait_flags & 1u;
+    awaiting_release = d->wait_flags & 2u;
+    vblank_wait = d->wait_flags & 4u;
+    std::copy(std::begin(d->registers), std::end(d->registers), registers);
+    std::copy(std::begin(d->flag_registers), std::end(d->flag_registers), flag_registers);
+    std::copy(std::begin(d->stack), std::end(d->stack), stack);
+    unpack_keys(d->keys, keys);
+    unpack_keys(d->pressed, just_pressed);
+    unpack_keys(d->released, just_released);
+    std::memcpy(lores_display.rows, d->display.data(), sizeof(lores_display.rows));
+    if(d->display.size() > LORES_WORDS) std::memcpy(hires_buffer->rows, d->display.data() + LORES_WORDS, sizeof(hires_buffer->rows));
+    plane_mask = (d->video >> 1) & 0x3u;
+    if(hires_mode != static_cast<bool>(d->video & 1u)) {
+        hires_mode = d->video & 1u;
+        init_tables(); // that resolution's handlers , the decode cache is cleared below
+    }
+    mark_display_changed(~0ull);
+    restore_memory(d->memory.data());
+
+    // jump over the CXNN draws so the random sequence continues where it left off
+    seed(d->rng_seed);
+    rng.advance(d->rng_draws);
+    rng_draws = d->rng_draws;
+
+    clear_decode_cache();
+    dirty_pages = d->page_mask; // a loaded delta is still relative to its base
+    state_base = base_sum;
+#ifdef CHIP8_PROFILE
+    prof.unwind(); // counts keep accumulating , but the call path we were tracking is gone
+#endif
+}
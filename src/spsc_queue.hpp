@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// bounded lock-free single producer / single consumer ring. CAPACITY must be a power of two.
+// push() fails instead of blocking when the consumer is CAPACITY entries behind.
+template<class T, std::size_t CAPACITY> class Spsc_queue {
+    static_assert(CAPACITY && (CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+    public:
+        bool push(const T& value) {
+            const std::size_t t = tail.load(std::memory_order_relaxed);
+            if(t - head.load(std::memory_order_acquire) == CAPACITY) return false;
+            ring[t & (CAPACITY - 1)] = value;
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+        bool pop(T& value) {
+            const std::size_t h = head.load(std::memory_order_relaxed);
+            if(h == tail.load(std::memory_order_acquire)) return false;
+            value = ring[h & (CAPACITY - 1)];
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+        bool empty() const {return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);} // consumer side
+
+    private:
+        std::array<T, CAPACITY> ring{};
+        alignas(64) std::atomic<std::size_t> head{0}; // next slot to pop , consumer owned
+        alignas(64) std::atomic<std::size_t> tail{0}; // next slot to fill , producer owned
+};
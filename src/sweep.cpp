@@ -0,0 +1,481 @@
+#include "chip8_emulator.hpp"
+#include "movie.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ROM sweep: runs every ROM x configuration job across a work-stealing thread pool and writes a JSON/CSV report.
+// each worker owns one Chip8System and drives it with load_ROM/cycle/tick_timers , checking for out-of-bounds
+// accesses before every instruction and for hangs at frame boundaries. no SDL.
+
+namespace {
+
+constexpr uint64_t TIMER_HZ = 60;
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " <rom|dir>... [--frames N] [--hz N,...] [--input SPEC,...] [--seed N] [--quirks NAME] [--threads N]" << std::endl;
+    std::cerr << "       [--timeout S] [--stall-frames N] [--format json|csv] [--out FILE]" << std::endl;
+    std::cerr << "  <rom|dir>         .ch8 files , directories are scanned (non recursively) for *.ch8" << std::endl;
+    std::cerr << "  --frames N        60Hz frames per job (default 3600)" << std::endl;
+    std::cerr << "  --hz N,...        cpu speeds to run every ROM at (default 700) , movie inputs keep their recorded speed" << std::endl;
+    std::cerr << "  --input SPEC,...  none , random:SEED , movie:FILE or a script file of '<frame> down|up <key>' lines (default none)" << std::endl;
+    std::cerr << "  --seed N          CXNN rng seed for every job without a movie (default 1)" << std::endl;
+    std::cerr << "  --quirks NAME     auto (guess per ROM , default) , hybrid , vip , chip48 , schip or xochip" << std::endl;
+    std::cerr << "  --threads N       worker threads (default: all cores)" << std::endl;
+    std::cerr << "  --timeout S       wall clock limit per job in seconds (default 10)" << std::endl;
+    std::cerr << "  --stall-frames N  frames without any state change that count as a hang (default 600 , 0 = off)" << std::endl;
+    std::cerr << "  --format FMT      report format , json (default) or csv" << std::endl;
+    std::cerr << "  --out FILE        write the report to FILE instead of stdout" << std::endl;
+}
+
+std::vector<std::string> split_list(const char* arg) {
+    std::vector<std::string> out;
+    std::stringstream ss(arg);
+    std::string item;
+    while(std::getline(ss, item, ',')) if(!item.empty()) out.push_back(item);
+    return out;
+}
+
+// scripted keypad input , applied at the start of each frame
+struct Key_event {
+    uint64_t frame;
+    uint8_t key;
+    bool down;
+};
+
+struct Input_script {
+    std::string name;
+    std::vector<Key_event> events; // sorted by frame
+    bool random{false};
+    uint32_t random_seed{0};
+    std::shared_ptr<const Movie> movie; // recorded input , also brings its own rng seed
+};
+
+Input_script parse_input(const std::string& spec) {
+    Input_script script;
+    script.name = spec;
+    if(spec == "none") return script;
+    if(spec.rfind("random:", 0) == 0) {
+        script.random = true;
+        script.random_seed = static_cast<uint32_t>(std::strtoul(spec.c_str() + 7, nullptr, 10));
+        return script;
+    }
+    if(spec.rfind("movie:", 0) == 0) {
+        script.movie = std::make_shared<const Movie>(Movie::load(spec.c_str() + 6));
+        return script;
+    }
+
+    std::ifstream in(spec);
+    if(!in) throw std::runtime_error("can't open input script " + spec);
+    std::string line;
+    for(std::size_t line_no = 1; std::getline(in, line); ++line_no) {
+        const std::size_t comment = line.find('#');
+        if(comment != std::string::npos) line.erase(comment);
+        std::stringstream ss(line);
+        uint64_t frame;
+        std::string action;
+        std::string key;
+        if(!(ss >> frame)) continue; // blank line
+        if(!(ss >> action >> key) || (action != "down" && action != "up")) {
+            throw std::runtime_error(spec + ":" + std::to_string(line_no) + ": expected '<frame> down|up <key>'");
+        }
+        const unsigned long value = std::strtoul(key.c_str(), nullptr, 16);
+        if(value >= Chip8System::INPUT_SIZE) throw std::runtime_error(spec + ":" + std::to_string(line_no) + ": key must be 0-F");
+        script.events.push_back({frame, static_cast<uint8_t>(value), action == "down"});
+    }
+    std::stable_sort(script.events.begin(), script.events.end(), [](const Key_event& a, const Key_event& b) {return a.frame < b.frame;});
+    return script;
+}
+
+struct Job {
+    std::string rom;
+    uint64_t hz; // the movie's own speed for movie inputs
+    const Input_script* input;
+};
+
+struct Result {
+    std::string status{"ok"}; // ok , halted , waiting , hang , oob , timeout , error
+    std::string detail;
+    uint64_t frames{0};
+    uint64_t instructions{0};
+    double wall_s{0.0};
+    uint64_t hash{0};
+    uint16_t pc{0};
+    Quirk_profile quirks{Quirk_profile::Hybrid}; // what the job ran with
+};
+
+struct Settings {
+    uint64_t frames{3600};
+    uint32_t seed{1};
+    double timeout_s{10.0};
+    uint64_t stall_frames{600};
+    bool auto_quirks{true}; // detect per ROM , otherwise every job runs quirks
+    Quirk_profile quirks{Quirk_profile::Hybrid};
+};
+
+// per-deque locks are plenty here , a job is thousands of frames so the queues are barely contended
+class Work_stealing_pool {
+    public:
+        explicit Work_stealing_pool(std::size_t workers) : queues(workers) {}
+
+        // runs fn(worker , job) for every job in [0 , jobs) , blocks until all are done
+        void run(std::size_t jobs, const std::function<void(std::size_t, std::size_t)>& fn) {
+            for(std::size_t j = 0; j < jobs; ++j) queues[j % queues.size()].jobs.push_back(j);
+            std::vector<std::thread> threads;
+            for(std::size_t w = 0; w < queues.size(); ++w) {
+                threads.emplace_back([this, w, &fn] {
+                    std::size_t job;
+                    while(pop(w, job)) fn(w, job);
+                });
+            }
+            for(std::thread& t : threads) t.join();
+        }
+
+    private:
+        struct Queue {
+            std::mutex lock;
+            std::deque<std::size_t> jobs;
+        };
+        std::vector<Queue> queues;
+
+        // own work from the front , stolen work from the back of the next non-empty queue
+        bool pop(std::size_t worker, std::size_t& job) {
+            {
+                Queue& own = queues[worker];
+                std::lock_guard<std::mutex> guard(own.lock);
+                if(!own.jobs.empty()) {
+                    job = own.jobs.front();
+                    own.jobs.pop_front();
+                    return true;
+                }
+            }
+            for(std::size_t i = 1; i < queues.size(); ++i) {
+                Queue& victim = queues[(worker + i) % queues.size()];
+                std::lock_guard<std::mutex> guard(victim.lock);
+                if(!victim.jobs.empty()) {
+                    job = victim.jobs.back();
+                    victim.jobs.pop_back();
+                    return true;
+                }
+            }
+            return false; // nothing gets queued after start , so empty everywhere means done
+        }
+};
+
+// true if any key changed this frame
+bool apply_input(Chip8System& chip8, const Input_script& script, std::size_t& next_event, uint32_t& lcg, uint64_t frame) {
+    std::fill(std::begin(chip8.just_pressed), std::end(chip8.just_pressed), 0);
+    std::fill(std::begin(chip8.just_released), std::end(chip8.just_released), 0);
+    bool changed = false;
+    auto set_key = [&](uint8_t key, bool down) {
+        if(down && !chip8.keys[key]) chip8.just_pressed[key] = 1;
+        else if(!down && chip8.keys[key]) chip8.just_released[key] = 1;
+        else return;
+        chip8.keys[key] = down;
+        changed = true;
+    };
+
+    if(script.movie) {
+        script.movie->apply(chip8, frame);
+        for(std::size_t k = 0; k < Chip8System::INPUT_SIZE; ++k) changed |= chip8.just_pressed[k] || chip8.just_released[k];
+    }
+    if(script.random) {
+        // roughly one press and one release every 8 frames on a random key
+        lcg = lcg * 1103515245u + 12345u;
+        const uint8_t key = (lcg >> 16) & 0xF;
+        if(((lcg >> 8) & 7) == 0) set_key(key, true);
+        else if(((lcg >> 12) & 7) == 0) set_key(key, false);
+    }
+    for(; next_event < script.events.size() && script.events[next_event].frame <= frame; ++next_event) {
+        set_key(script.events[next_event].key, script.events[next_event].down);
+    }
+    return changed;
+}
+
+// state that has to move for a ROM to be making progress , compared at frame boundaries
+struct Progress {
+    Chip8System::Debug_snapshot snap;
+    uint64_t hash;
+    std::vector<uint8_t> memory;
+    explicit Progress(const Chip8System& chip8) : snap(chip8.snapshot()), hash(chip8.display_hash()), memory(chip8.memory_bytes()) {
+        chip8.read_memory(0, memory);
+    }
+    bool operator==(const Progress& o) const {
+        return hash == o.hash && snap.pc == o.snap.pc && snap.i == o.snap.i && snap.sp == o.snap.sp && snap.dt == o.snap.dt
+            && snap.st == o.snap.st && snap.registers == o.snap.registers && snap.stack == o.snap.stack && memory == o.memory;
+    }
+};
+
+Result run_job(Chip8System& chip8, const Job& job, const Settings& settings) {
+    Result result;
+    const auto start = std::chrono::steady_clock::now();
+    auto finish = [&](const char* status, std::string detail) {
+        result.status = status;
+        result.detail = std::move(detail);
+    };
+
+    try {
+        chip8.reset();
+        chip8.seed(job.input->movie ? job.input->movie->seed() : settings.seed);
+        chip8.load_ROM(job.rom.c_str());
+        // workers reuse their VM and reset() keeps the profile , so every job picks its own
+        if(job.input->movie) chip8.set_quirks(job.input->movie->quirks()); // like its seed
+        else chip8.set_quirks(settings.auto_quirks ? chip8.detect_rom_quirks() : settings.quirks);
+        result.quirks = chip8.current_quirks();
+    } catch(const std::exception& ex) {
+        finish("error", ex.what());
+        return result;
+    }
+
+    std::size_t next_event = 0;
+    uint32_t lcg = job.input->random_seed;
+    uint64_t cycles = 0;
+    uint64_t stalled_frames = 0;
+    bool input_since_check = false;
+    std::unique_ptr<Progress> last; // compared once per second of emulated time , not every frame
+    while(result.frames < settings.frames) {
+        input_since_check |= apply_input(chip8, *job.input, next_event, lcg, result.frames);
+        const uint64_t frame_end = ((result.frames + 1) * job.hz) / TIMER_HZ;
+        for(; cycles < frame_end; ++cycles) {
+            if(const char* fault = chip8.fault()) {
+                finish("oob", fault);
+                break;
+            }
+            chip8.cycle();
+        }
+        if(result.status != "ok") break;
+        chip8.tick_timers();
+        ++result.frames;
+
+        if(chip8.halted()) {
+            // nothing but the timers can change from here , no need to burn the rest of the budget
+            finish("halted", "");
+            break;
+        }
+        if(result.frames % TIMER_HZ != 0) continue;
+
+        // a whole second with identical state , no input and no key wait is a loop the ROM can't leave
+        if(settings.stall_frames) {
+            auto now = std::make_unique<Progress>(chip8);
+            const bool idle = last && *last == *now && !input_since_check && !chip8.waiting_for_key();
+            stalled_frames = idle ? stalled_frames + TIMER_HZ : 0;
+            last = std::move(now);
+            input_since_check = false;
+            if(stalled_frames >= settings.stall_frames) {
+                finish("hang", "no state change for " + std::to_string(stalled_frames) + " frames");
+                break;
+            }
+        }
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if(elapsed > settings.timeout_s) {
+            finish("timeout", "stopped after " + std::to_string(result.frames) + " frames");
+            break;
+        }
+    }
+    if(result.status == "ok" && chip8.waiting_for_key()) finish("waiting", "blocked on FX0A");
+
+    result.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.instructions = cycles;
+    result.hash = chip8.display_hash();
+    result.pc = chip8.view().pc;
+    return result;
+}
+
+std::string json_escape(const std::string& s) {
+    std::string out;
+    for(const char c : s) {
+        if(c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if(static_cast<unsigned char>(c) < 0x20) {
+            std::ostringstream esc;
+            esc << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c);
+            out += esc.str();
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+std::string csv_escape(const std::string& s) {
+    if(s.find_first_of(",\"\n") == std::string::npos) return s;
+    std::string out = "\"";
+    for(const char c : s) {
+        if(c == '"') out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+std::string hex(uint64_t value, int width) {
+    std::ostringstream out;
+    out << "0x" << std::hex << std::setw(width) << std::setfill('0') << value;
+    return out.str();
+}
+
+void write_json(std::ostream& out, const std::vector<Job>& jobs, const std::vector<Result>& results, const Settings& settings) {
+    out << "{\n  \"frames\": " << settings.frames << ",\n  \"seed\": " << settings.seed << ",\n  \"jobs\": [\n";
+    for(std::size_t i = 0; i < jobs.size(); ++i) {
+        const Result& r = results[i];
+        out << "    {\"rom\": \"" << json_escape(jobs[i].rom) << "\", \"hz\": " << jobs[i].hz
+            << ", \"input\": \"" << json_escape(jobs[i].input->name) << "\", \"quirks\": \"" << quirk_name(r.quirks) << "\", \"status\": \"" << r.status
+            << "\", \"detail\": \"" << json_escape(r.detail) << "\", \"frames\": " << r.frames
+            << ", \"instructions\": " << r.instructions << ", \"wall_s\": " << std::fixed << std::setprecision(6) << r.wall_s
+            << ", \"pc\": \"" << hex(r.pc, 3) << "\", \"hash\": \"" << hex(r.hash, 16) << "\"}"
+            << (i + 1 < jobs.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+void write_csv(std::ostream& out, const std::vector<Job>& jobs, const std::vector<Result>& results) {
+    out << "rom,hz,input,quirks,status,detail,frames,instructions,wall_s,pc,hash\n";
+    for(std::size_t i = 0; i < jobs.size(); ++i) {
+        const Result& r = results[i];
+        out << csv_escape(jobs[i].rom) << ',' << jobs[i].hz << ',' << csv_escape(jobs[i].input->name) << ',' << quirk_name(r.quirks) << ',' << r.status << ','
+            << csv_escape(r.detail) << ',' << r.frames << ',' << r.instructions << ',' << std::fixed << std::setprecision(6)
+            << r.wall_s << ',' << hex(r.pc, 3) << ',' << hex(r.hash, 16) << '\n';
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<std::string> roms;
+    std::vector<uint64_t> speeds;
+    std::vector<std::string> input_specs;
+    Settings settings;
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string format = "json";
+    std::string out_path;
+
+    try {
+        for(int i = 1; i < argc; ++i) {
+            const bool has_value = i + 1 < argc;
+            if(std::strcmp(argv[i], "--frames") == 0 && has_value) {
+                settings.frames = std::strtoull(argv[++i], nullptr, 10);
+            } else if(std::strcmp(argv[i], "--hz") == 0 && has_value) {
+                for(const std::string& hz : split_list(argv[++i])) speeds.push_back(std::strtoull(hz.c_str(), nullptr, 10));
+            } else if(std::strcmp(argv[i], "--input") == 0 && has_value) {
+                for(const std::string& spec : split_list(argv[++i])) input_specs.push_back(spec);
+            } else if(std::strcmp(argv[i], "--seed") == 0 && has_value) {
+                settings.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            } else if(std::strcmp(argv[i], "--quirks") == 0 && has_value) {
+                const char* name = argv[++i];
+                settings.auto_quirks = std::strcmp(name, "auto") == 0;
+                if(!settings.auto_quirks && !parse_quirk_profile(name, settings.quirks)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+            } else if(std::strcmp(argv[i], "--threads") == 0 && has_value) {
+                threads = std::max<std::size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+            } else if(std::strcmp(argv[i], "--timeout") == 0 && has_value) {
+                settings.timeout_s = std::strtod(argv[++i], nullptr);
+            } else if(std::strcmp(argv[i], "--stall-frames") == 0 && has_value) {
+                settings.stall_frames = std::strtoull(argv[++i], nullptr, 10);
+            } else if(std::strcmp(argv[i], "--format") == 0 && has_value) {
+                format = argv[++i];
+                if(format != "json" && format != "csv") {
+                    usage(argv[0]);
+                    return 1;
+                }
+            } else if(std::strcmp(argv[i], "--out") == 0 && has_value) {
+                out_path = argv[++i];
+            } else if(argv[i][0] == '-') {
+                usage(argv[0]);
+                return 1;
+            } else if(std::filesystem::is_directory(argv[i])) {
+                std::vector<std::string> found;
+                for(const auto& entry : std::filesystem::directory_iterator(argv[i])) {
+                    if(entry.is_regular_file() && entry.path().extension() == ".ch8") found.push_back(entry.path().string());
+                }
+                std::sort(found.begin(), found.end());
+                roms.insert(roms.end(), found.begin(), found.end());
+            } else {
+                roms.push_back(argv[i]);
+            }
+        }
+    } catch(const std::exception& ex) {
+        std::cerr << "Bad arguments: " << ex.what() << std::endl;
+        return 1;
+    }
+    if(roms.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+    if(speeds.empty()) speeds.push_back(700);
+    if(input_specs.empty()) input_specs.push_back("none");
+    if(std::find(speeds.begin(), speeds.end(), 0) != speeds.end()) {
+        std::cerr << "--hz must be greater than 0" << std::endl;
+        return 1;
+    }
+
+    std::vector<Input_script> inputs;
+    try {
+        for(const std::string& spec : input_specs) inputs.push_back(parse_input(spec));
+    } catch(const std::exception& ex) {
+        std::cerr << "Failed to load input: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    std::vector<Job> jobs;
+    for(const std::string& rom : roms) {
+        for(std::size_t s = 0; s < speeds.size(); ++s) {
+            for(const Input_script& input : inputs) {
+                // a movie only replays at the speed it was recorded at , so it runs once per ROM at that speed
+                if(!input.movie) jobs.push_back({rom, speeds[s], &input});
+                else if(s == 0) jobs.push_back({rom, input.movie->cpu_hz(), &input});
+            }
+        }
+    }
+    threads = std::min(threads, jobs.size());
+
+    std::vector<Result> results(jobs.size());
+    std::vector<std::unique_ptr<Chip8System>> machines;
+    for(std::size_t w = 0; w < threads; ++w) machines.push_back(std::make_unique<Chip8System>()); // one VM per worker , reused across jobs
+    std::atomic<std::size_t> done{0};
+
+    const auto start = std::chrono::steady_clock::now();
+    Work_stealing_pool pool(threads);
+    pool.run(jobs.size(), [&](std::size_t worker, std::size_t job) {
+        results[job] = run_job(*machines[worker], jobs[job], settings);
+        const std::size_t finished = ++done;
+        if(finished % 64 == 0) std::cerr << finished << "/" << jobs.size() << " jobs" << std::endl;
+    });
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::ofstream file;
+    if(!out_path.empty()) {
+        file.open(out_path);
+        if(!file) {
+            std::cerr << "Can't write " << out_path << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = out_path.empty() ? std::cout : file;
+    if(format == "json") write_json(out, jobs, results, settings);
+    else write_csv(out, jobs, results);
+
+    // oob , timeouts and load errors fail the sweep , the other statuses are informational
+    std::size_t failed = 0;
+    for(const Result& r : results) failed += r.status == "oob" || r.status == "timeout" || r.status == "error";
+    std::cerr << jobs.size() << " jobs on " << threads << " threads in " << std::fixed << std::setprecision(2) << elapsed << "s , "
+              << failed << " failed" << std::endl;
+    return failed ? 2 : 0;
+}
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#include "trace.hpp"
+
+namespace {
+
+constexpr char TRACE_MAGIC[4] = {'C', '8', 'T', 'R'};
+constexpr std::size_t HEADER_SIZE = 4 + 2 + 8 + 8;
+constexpr std::size_t RECORD_SIZE = 8;
+
+template<class T> void put(std::vector<uint8_t>& out, T value) {
+    for(std::size_t i = 0; i < sizeof(T); ++i) out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i)));
+}
+
+template<class T> T get(const std::vector<uint8_t>& in, std::size_t& pos) {
+    if(in.size() - pos < sizeof(T)) throw std::runtime_error("trace truncated");
+    uint64_t value = 0;
+    for(std::size_t i = 0; i < sizeof(T); ++i) value |= static_cast<uint64_t>(in[pos++]) << (8 * i);
+    return static_cast<T>(value);
+}
+
+Trace_record unpack(uint64_t packed) {
+    return {static_cast<uint16_t>(packed >> 48), static_cast<uint16_t>(packed >> 32), static_cast<uint16_t>(packed >> 16),
+            static_cast<uint8_t>(packed >> 8), static_cast<uint8_t>(packed)};
+}
+
+} // namespace
+
+Trace_ring::Trace_ring(std::size_t capacity)
+    : slots(std::make_unique<std::atomic<uint64_t>[]>(std::bit_ceil(std::max<std::size_t>(capacity, 1)))),
+      mask(std::bit_ceil(std::max<std::size_t>(capacity, 1)) - 1) {}
+
+Trace_ring::Dump Trace_ring::snapshot() const {
+    const uint64_t end = head.load(std::memory_order_acquire);
+    const uint64_t held = std::min<uint64_t>(end, capacity());
+    std::vector<uint64_t> copy(held);
+    for(uint64_t n = end - held; n < end; ++n) copy[n - (end - held)] = slots[n & mask].load(std::memory_order_relaxed);
+    // the writer may have lapped the oldest slots while we copied (and may be mid-write on the next one). the fence
+    // keeps the slot loads above ahead of this head load , so any slot we copied after it was overwritten is dropped
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t now = head.load(std::memory_order_relaxed);
+    const uint64_t first_safe = now >= capacity() ? now - capacity() + 1 : 0;
+    const uint64_t skip = std::min<uint64_t>(held, first_safe > end - held ? first_safe - (end - held) : 0);
+    Dump out;
+    out.recorded = end; // not recorded() , which may have moved on since
+    out.records.reserve(held - skip);
+    for(uint64_t k = skip; k < held; ++k) out.records.push_back(unpack(copy[k]));
+    return out;
+}
+
+void Trace_ring::save(const char* path) const {
+    const Dump dump = snapshot();
+    std::vector<uint8_t> out;
+    out.reserve(HEADER_SIZE + dump.records.size() * RECORD_SIZE);
+    for(const char c : TRACE_MAGIC) out.push_back(static_cast<uint8_t>(c));
+    put<uint16_t>(out, VERSION);
+    put<uint64_t>(out, dump.recorded);
+    put<uint64_t>(out, dump.records.size());
+    for(const Trace_record& r : dump.records) {
+        put<uint16_t>(out, r.pc);
+        put<uint16_t>(out, r.opcode);
+        put<uint16_t>(out, r.i);
+        put<uint8_t>(out, r.reg);
+        put<uint8_t>(out, r.value);
+    }
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+    if(!file) throw std::runtime_error(std::string("can't write ") + path);
+}
+
+Trace_ring::Dump Trace_ring::load(const char* path) {
+    std::ifstream file(path, std::ios::binary);
+    if(!file) throw std::runtime_error(std::string("can't open ") + path);
+    const std::vector<uint8_t> in{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    std::size_t pos = 0;
+    for(const char c : TRACE_MAGIC) {
+        if(get<uint8_t>(in, pos) != static_cast<uint8_t>(c)) throw std::runtime_error("not a chip8 trace");
+    }
+    const uint16_t version = get<uint16_t>(in, pos);
+    if(version != VERSION) throw std::runtime_error("unsupported trace version " + std::to_string(version));
+    Dump dump;
+    dump.recorded = get<uint64_t>(in, pos);
+    const uint64_t count = get<uint64_t>(in, pos);
+    if(count > (in.size() - pos) / RECORD_SIZE || count > dump.recorded) throw std::runtime_error("trace truncated");
+    dump.records.reserve(count);
+    for(uint64_t k = 0; k < count; ++k) {
+        Trace_record r;
+        r.pc = get<uint16_t>(in, pos);
+        r.opcode = get<uint16_t>(in, pos);
+        r.i = get<uint16_t>(in, pos);
+        r.reg = get<uint8_t>(in, pos);
+        r.value = get<uint8_t>(in, pos);
+        dump.records.push_back(r);
+    }
+    if(pos != in.size()) throw std::runtime_error("trailing bytes after trace");
+    return dump;
+}
+
+std::string Trace_ring::disassemble(uint16_t op) {
+    // Cowgod's mnemonics , with the SUPER-CHIP/XO-CHIP additions named the way Octo documents them
+    const unsigned x = (op >> 8) & 0xF, y = (op >> 4) & 0xF, n = op & 0xF, nn = op & 0xFF, nnn = op & 0xFFF;
+    char buf[32];
+    auto out = [&](const char* format, auto... args) {
+        std::snprintf(buf, sizeof(buf), format, args...);
+        return std::string(buf);
+    };
+    switch(op >> 12) {
+        case 0x0:
+            if(op == 0x00E0) return "CLS";
+            if(op == 0x00EE) return "RET";
+            if(op == 0x00FB) return "SCR";
+            if(op == 0x00FC) return "SCL";
+            if(op == 0x00FD) return "EXIT";
+            if(op == 0x00FE) return "LOW";
+            if(op == 0x00FF) return "HIGH";
+            if((op & 0xFFF0) == 0x00C0) return out("SCD %u", n);
+            if((op & 0xFFF0) == 0x00D0) return out("SCU %u", n);
+            return out("SYS 0x%03X", nnn);
+        case 0x1: return out("JP 0x%03X", nnn);
+        case 0x2: return out("CALL 0x%03X", nnn);
+        case 0x3: return out("SE V%X, 0x%02X", x, nn);
+        case 0x4: return out("SNE V%X, 0x%02X", x, nn);
+        case 0x5:
+            if(n == 0) return out("SE V%X, V%X", x, y);
+            if(n == 2) return out("SAVE V%X-V%X", x, y);
+            if(n == 3) return out("LOAD V%X-V%X", x, y);
+            break;
+        case 0x6: return out("LD V%X, 0x%02X", x, nn);
+        case 0x7: return out("ADD V%X, 0x%02X", x, nn);
+        case 0x8: {
+            static constexpr const char* ALU[16] = {"LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+                                                    nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "SHL", nullptr};
+            if(ALU[n]) return out("%s V%X, V%X", ALU[n], x, y);
+            break;
+        }
+        case 0x9: if(n == 0) return out("SNE V%X, V%X", x, y); break;
+        case 0xA: return out("LD I, 0x%03X", nnn);
+        case 0xB: return out("JP V0, 0x%03X", nnn);
+        case 0xC: return out("RND V%X, 0x%02X", x, nn);
+        case 0xD: return out("DRW V%X, V%X, %u", x, y, n);
+        case 0xE:
+            if(nn == 0x9E) return out("SKP V%X", x);
+            if(nn == 0xA1) return out("SKNP V%X", x);
+            break;
+        case 0xF:
+            if(op == 0xF000) return "LD I, long"; // the address is the next word , the record's I shows it
+            if(op == 0xF002) return "AUDIO";
+            switch(nn) {
+                case 0x01: return out("PLANE %u", x);
+                case 0x07: return out("LD V%X, DT", x);
+                case 0x0A: return out("LD V%X, K", x);
+                case 0x15: return out("LD DT, V%X", x);
+                case 0x18: return out("LD ST, V%X", x);
+                case 0x1E: return out("ADD I, V%X", x);
+                case 0x29: return out("LD F, V%X", x);
+                case 0x30: return out("LD HF, V%X", x);
+                case 0x33: return out("LD B, V%X", x);
+                case 0x3A: return out("PITCH V%X", x);
+                case 0x55: return out("LD [I], V%X", x);
+                case 0x65: return out("LD V%X, [I]", x);
+                case 0x75: return out("LD R, V%X", x);
+                case 0x85: return out("LD V%X, R", x);
+            }
+            break;
+    }
+    return out("DW 0x%04X", op);
+}
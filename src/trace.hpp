@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// one executed instruction , 8 bytes: where it ran , what it was , I afterwards and the lowest numbered register it
+// changed (reg == NO_REGISTER when it changed none)
+struct Trace_record {
+    static constexpr uint8_t NO_REGISTER = 0x10;
+    uint16_t pc{};
+    uint16_t opcode{};
+    uint16_t i{};
+    uint8_t reg{NO_REGISTER};
+    uint8_t value{};
+};
+
+// the last capacity() instructions a Chip8System executed , filled by the thread running it. every slot is a
+// packed u64 written with a relaxed store and the head is published with a release store (plain moves on x86) ,
+// so snapshot() can copy it out from any thread without stopping the VM. older records are simply overwritten
+class Trace_ring {
+    public:
+        static constexpr std::size_t DEFAULT_CAPACITY = std::size_t{1} << 20; // 8MB
+
+        explicit Trace_ring(std::size_t capacity = DEFAULT_CAPACITY); // rounded up to a power of two
+
+        void record(uint16_t pc, uint16_t opcode, uint16_t i, uint8_t reg, uint8_t value) {
+            const uint64_t n = head.load(std::memory_order_relaxed);
+            const uint64_t packed = static_cast<uint64_t>(pc) << 48 | static_cast<uint64_t>(opcode) << 32
+                | static_cast<uint64_t>(i) << 16 | static_cast<uint64_t>(reg) << 8 | value;
+            // pairs with the fence in snapshot(): a reader that sees this slot's new value also sees head >= n
+            std::atomic_thread_fence(std::memory_order_release);
+            slots[n & mask].store(packed, std::memory_order_relaxed);
+            head.store(n + 1, std::memory_order_release);
+        }
+        std::size_t capacity() const {return mask + 1;}
+        uint64_t recorded() const {return head.load(std::memory_order_acquire);} // ever , not just what's still held
+        struct Dump {
+            uint64_t recorded{0}; // instructions recorded up to the newest record , its seq is recorded - 1
+            std::vector<Trace_record> records; // oldest first
+        };
+        Dump snapshot() const; // records overwritten while copying are dropped
+
+        // trace file (little endian): "C8TR" , u16 version , u64 instructions recorded in total , u64 record count ,
+        // then the records oldest first as u16 pc , u16 opcode , u16 I , u8 reg , u8 value
+        static constexpr uint16_t VERSION = 1;
+        void save(const char* path) const; // throws std::runtime_error
+        static Dump load(const char* path);
+
+        static std::string disassemble(uint16_t opcode); // "DRW V1, V2, 5" , SUPER-CHIP/XO-CHIP included
+
+    private:
+        std::unique_ptr<std::atomic<uint64_t>[]> slots;
+        std::size_t mask;
+        std::atomic<uint64_t> head{0};
+};
@@ -0,0 +1,54 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+#include "trace.hpp"
+
+// offline trace decoder: prints a trace file written by --trace / F7 as a disassembled listing , oldest first.
+// seq numbers count every instruction since tracing started , so they line up across dumps of the same run
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " <trace> [--last N]" << std::endl;
+    std::cerr << "  --last N  only the N newest instructions (default all of them)" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if(argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    uint64_t last = 0; // 0 = everything in the file
+    for(int i = 2; i < argc; ++i) {
+        if(std::strcmp(argv[i], "--last") == 0 && i + 1 < argc) {
+            last = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Trace_ring::Dump dump;
+    try {
+        dump = Trace_ring::load(argv[1]);
+    } catch(const std::exception& ex) {
+        std::cerr << "Failed to read trace: " << ex.what() << std::endl;
+        return 1;
+    }
+    const uint64_t held = dump.records.size();
+    const uint64_t from = last && last < held ? held - last : 0;
+    std::printf("# %llu of %llu instructions , oldest first\n", static_cast<unsigned long long>(held - from),
+        static_cast<unsigned long long>(dump.recorded));
+    std::printf("#%11s  %-6s  %-4s  %-18s  %-6s  %s\n", "seq", "pc", "op", "instruction", "I", "changed");
+    const uint64_t first_seq = dump.recorded - held; // instructions that fell out of the ring before the dump
+    for(uint64_t k = from; k < held; ++k) {
+        const Trace_record& r = dump.records[k];
+        char changed[16] = "";
+        if(r.reg < Trace_record::NO_REGISTER) std::snprintf(changed, sizeof(changed), "V%X=%02X", r.reg, r.value);
+        std::printf("%12llu  0x%04X  %04X  %-18s  0x%04X  %s\n", static_cast<unsigned long long>(first_seq + k), r.pc, r.opcode,
+            Trace_ring::disassemble(r.opcode).c_str(), r.i, changed);
+    }
+    return 0;
+}
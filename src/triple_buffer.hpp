@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// lock-free triple buffer , one writer thread and one reader thread.
+// the writer fills back() and publish()es it , the reader picks up the newest published slot with update().
+// neither side ever waits: the writer always has a free slot and the reader keeps its slot until a newer one is out.
+// frames the reader was too slow for are simply overwritten.
+template<class T> class Triple_buffer {
+    public:
+        // writer side
+        T& back() {return slots[back_index];}
+        void publish() {back_index = shared.exchange(static_cast<uint8_t>(back_index | FRESH), std::memory_order_acq_rel) & INDEX;}
+
+        // reader side , true when front() changed
+        bool update() {
+            if(!(shared.load(std::memory_order_relaxed) & FRESH)) return false;
+            front_index = shared.exchange(front_index, std::memory_order_acq_rel) & INDEX;
+            return true;
+        }
+        const T& front() const {return slots[front_index];}
+
+    private:
+        static constexpr uint8_t INDEX = 0x3;
+        static constexpr uint8_t FRESH = 0x4; // set on the shared index when it holds a frame the reader hasn't taken
+
+        std::array<T, 3> slots{};
+        alignas(64) uint8_t back_index{0}; // writer only
+        alignas(64) uint8_t front_index{1}; // reader only
+        alignas(64) std::atomic<uint8_t> shared{2};
+};